@@ -0,0 +1,96 @@
+#!/bin/bash
+# build-restore.sh - Link a checkpoint restore stub ahead of a program's memory image
+
+# Exit on error
+set -e
+
+# Color definitions and symbols
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+BLUE='\033[0;34m'
+CYAN='\033[0;36m'
+NC='\033[0m' # No Color
+
+# Unicode symbols
+CHECK_MARK="✓"
+CROSS_MARK="✗"
+INFO="ℹ"
+GEAR="⚙"
+
+print_success() {
+    echo -e "${GREEN}${CHECK_MARK}${NC} $1"
+}
+
+print_error() {
+    echo -e "${RED}${CROSS_MARK}${NC} $1" >&2
+}
+
+print_info() {
+    echo -e "${BLUE}${INFO}${NC} $1"
+}
+
+print_processing() {
+    echo -e "${CYAN}${GEAR}${NC} $1"
+}
+
+# Script's directory to find co-located files
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+
+# Input arguments
+if [ "$#" -ne 3 ]; then
+    print_error "Usage: $0 <program.elf> <restore_stub.S> <output.elf>"
+    exit 1
+fi
+PROGRAM_ELF=$1
+STUB_S_FILE=$2
+OUTPUT_ELF=$3
+
+# Configuration
+RISCV_PATH=${RISCV:-$HOME/riscv32}
+CC="$RISCV_PATH/bin/riscv32-unknown-elf-gcc"
+OBJCOPY="$RISCV_PATH/bin/riscv32-unknown-elf-objcopy"
+
+if [ ! -x "$CC" ]; then
+    print_error "Compiler $CC not found or not executable"
+    exit 1
+fi
+
+LINKER_SCRIPT="$SCRIPT_DIR/restore.ld"
+WORK_DIR="$(dirname "$OUTPUT_ELF")"
+OUTPUT_BASE="${OUTPUT_ELF%.elf}"
+
+# The program image is flattened from its load addresses (0x80000000 onwards)
+# and wrapped in an object so the stub can be linked in front of it.
+print_processing "Extracting memory image of $PROGRAM_ELF..."
+if ! $OBJCOPY -O binary "$PROGRAM_ELF" "$OUTPUT_BASE.image.bin" 2>/dev/null; then
+    print_error "Failed to extract memory image"
+    exit 1
+fi
+if ! (cd "$WORK_DIR" && $OBJCOPY -I binary -O elf32-littleriscv -B riscv \
+        --rename-section .data=.image,alloc,load,contents \
+        "$(basename "$OUTPUT_BASE.image.bin")" "$(basename "$OUTPUT_BASE.image.o")" 2>/dev/null); then
+    print_error "Failed to wrap memory image"
+    exit 1
+fi
+
+print_processing "Assembling restore stub $STUB_S_FILE..."
+if ! $CC -march=rv32i -mabi=ilp32 -c "$STUB_S_FILE" -o "$OUTPUT_BASE.stub.o" 2>/dev/null; then
+    print_error "Failed to assemble restore stub"
+    exit 1
+fi
+
+if ! $CC -march=rv32i -mabi=ilp32 -nostdlib -nostartfiles -static -Wl,--no-warn-rwx-segments \
+        -T"$LINKER_SCRIPT" -o "$OUTPUT_ELF" "$OUTPUT_BASE.image.o" "$OUTPUT_BASE.stub.o" 2>/dev/null; then
+    print_error "Failed to link restore image"
+    exit 1
+fi
+
+if ! $OBJCOPY -O verilog "$OUTPUT_ELF" "$OUTPUT_BASE.hex" 2>/dev/null; then
+    print_error "Failed to generate HEX file for restore image"
+    exit 1
+fi
+
+rm -f "$OUTPUT_BASE.image.bin" "$OUTPUT_BASE.image.o" "$OUTPUT_BASE.stub.o"
+
+print_success "Built restore image $OUTPUT_ELF"
+print_info "  HEX: $OUTPUT_BASE.hex"
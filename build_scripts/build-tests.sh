@@ -49,17 +49,26 @@ print_header() {
 SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
 
 # Input arguments
-if [ "$#" -ne 2 ]; then
-    print_error "Usage: $0 <test_source_directory> <output_base_directory>"
+if [ "$#" -lt 2 ]; then
+    print_error "Usage: $0 <test_source_directory> <output_base_directory> [test_file ...]"
     exit 1
 fi
 TEST_SRC_DIR=$1
 OUTPUT_BASE_DIR=$2
+shift 2
+# Optional subset of tests to build (file names or paths); all test*.c and test*.S when empty
+SELECTED_TESTS=("$@")
 
 print_header "RV32I Test Compilation Script"
 
 # Configuration
 RISCV_PATH=${RISCV:-$HOME/riscv32}
+# Link runtime.S ahead of libgcc for *, / and %; USE_RUNTIME=0 links plain libgcc
+USE_RUNTIME=${USE_RUNTIME:-1}
+# Extra compiler flags, e.g. EXTRA_CFLAGS=-ffunction-sections for profile-guided layout
+read -r -a EXTRA_CFLAGS_LIST <<< "${EXTRA_CFLAGS:-}"
+# Directory of per-test linker scripts (<test>.ld) overriding linker.ld
+LAYOUT_DIR=${LAYOUT_DIR:-}
 CC="$RISCV_PATH/bin/riscv32-unknown-elf-gcc"
 OBJCOPY="$RISCV_PATH/bin/riscv32-unknown-elf-objcopy"
 OBJDUMP="$RISCV_PATH/bin/riscv32-unknown-elf-objdump"
@@ -76,6 +85,7 @@ print_success "Found RISC-V toolchain at $RISCV_PATH"
 # Linker script and startup file paths (assumed to be with the script)
 LINKER_SCRIPT="$SCRIPT_DIR/linker.ld"
 STARTUP_S_FILE="$SCRIPT_DIR/startup.S"
+RUNTIME_S_FILE="$SCRIPT_DIR/runtime.S"
 
 if [ ! -f "$LINKER_SCRIPT" ]; then
     print_error "Linker script $LINKER_SCRIPT not found. It should be in the same directory as build-tests.sh."
@@ -85,12 +95,16 @@ if [ ! -f "$STARTUP_S_FILE" ]; then
     print_error "Startup file $STARTUP_S_FILE not found. It should be in the same directory as build-tests.sh."
     exit 1
 fi
+if [ "$USE_RUNTIME" != "0" ] && [ ! -f "$RUNTIME_S_FILE" ]; then
+    print_error "Runtime library $RUNTIME_S_FILE not found. It should be in the same directory as build-tests.sh."
+    exit 1
+fi
 
 print_success "Found linker script and startup files"
 
 # Flags for RV32I bare-metal compilation
-CFLAGS=(-march=rv32i -mabi=ilp32 -nostdlib -nostartfiles -static -ffreestanding -O2 -Wl,--no-warn-rwx-segments)
-LDFLAGS="-T$LINKER_SCRIPT"
+CFLAGS=(-march=rv32i -mabi=ilp32 -nostdlib -nostartfiles -static -ffreestanding -O2 -Wl,--no-warn-rwx-segments
+        "${EXTRA_CFLAGS_LIST[@]}")
 
 # Create output directories within the specified output base directory
 BIN_DIR="$OUTPUT_BASE_DIR/bin"
@@ -110,23 +124,45 @@ else
     exit 1
 fi
 
+# Compile the multiply/divide runtime
+RUNTIME_OBJS=()
+if [ "$USE_RUNTIME" != "0" ]; then
+    print_processing "Compiling runtime library ($RUNTIME_S_FILE)..."
+    if $CC "${CFLAGS[@]}" -c "$RUNTIME_S_FILE" -o "$BIN_DIR/runtime.o" 2>/dev/null; then
+        RUNTIME_OBJS=("$BIN_DIR/runtime.o")
+        print_success "Compiled runtime library"
+    else
+        print_error "Failed to compile runtime library"
+        exit 1
+    fi
+else
+    print_warning "USE_RUNTIME=0: using the libgcc multiply/divide helpers"
+fi
+
 # Compile and link each test
 compile_test() {
     local test_full_path=$1
     local test_file_name=$(basename "$test_full_path")
-    local output_base=$(basename "$test_file_name" .c)
+    local output_base="${test_file_name%.*}"
 
     print_processing "Compiling $test_file_name..."
 
-    # Compile the actual test file
-    if ! $CC "${CFLAGS[@]}" -c "$test_full_path" -o "$BIN_DIR/${output_base}.o" 2>/dev/null; then
+    # Compile the actual test file (C, or assembly through the preprocessor),
+    # recording its header dependencies for watch mode
+    if ! $CC "${CFLAGS[@]}" -MMD -MF "$BIN_DIR/${output_base}.d" -c "$test_full_path" \
+        -o "$BIN_DIR/${output_base}.o" 2>/dev/null; then
         print_error "Failed to compile $test_file_name"
         return 1
     fi
 
-    # Link with startup code
-    if ! $CC "${CFLAGS[@]}" "$LDFLAGS" -o "$BIN_DIR/${output_base}.elf" \
-        "$BIN_DIR/startup.o" "$BIN_DIR/${output_base}.o" -lgcc 2>/dev/null; then
+    # Link with startup code; the runtime objects come first so libgcc only fills the gaps
+    local linker_script="$LINKER_SCRIPT"
+    if [ -n "$LAYOUT_DIR" ] && [ -f "$LAYOUT_DIR/${output_base}.ld" ]; then
+        linker_script="$LAYOUT_DIR/${output_base}.ld"
+        print_info "  Using layout $linker_script"
+    fi
+    if ! $CC "${CFLAGS[@]}" "-T$linker_script" -o "$BIN_DIR/${output_base}.elf" \
+        "$BIN_DIR/startup.o" "${RUNTIME_OBJS[@]}" "$BIN_DIR/${output_base}.o" -lgcc 2>/dev/null; then
         print_error "Failed to link $test_file_name"
         return 1
     fi
@@ -173,15 +209,32 @@ successful_tests=0
 # Temporarily disable exit on error for individual test compilation
 set +e
 
+list_tests() {
+    if [ "${#SELECTED_TESTS[@]}" -eq 0 ]; then
+        find "$TEST_SRC_DIR" \( -name 'test*.c' -o -name 'test*.S' \) -type f -print0
+        return
+    fi
+    local test
+    for test in "${SELECTED_TESTS[@]}"; do
+        if [ ! -f "$test" ]; then
+            test="$TEST_SRC_DIR/$test"
+        fi
+        printf '%s\0' "$test"
+    done
+}
+
 # Use find to robustly handle cases with no matches or special filenames
 while IFS= read -r -d $'\0' test_file_path; do
-    if compile_test "$test_file_path"; then
+    if [ ! -f "$test_file_path" ]; then
+        print_error "Test source $test_file_path not found"
+        failed_tests=$((failed_tests + 1))
+    elif compile_test "$test_file_path"; then
         successful_tests=$((successful_tests + 1))
     else
         failed_tests=$((failed_tests + 1))
     fi
     found_tests=$((found_tests + 1))
-done < <(find "$TEST_SRC_DIR" -maxdepth 1 -name 'test*.c' -type f -print0)
+done < <(list_tests)
 
 # Re-enable exit on error
 set -e
@@ -189,7 +242,7 @@ set -e
 echo # Empty line for spacing
 
 if [ "$found_tests" -eq 0 ]; then
-    print_warning "No .c test files found matching 'test*.c' in $TEST_SRC_DIR"
+    print_warning "No test files found matching 'test*.c' or 'test*.S' in $TEST_SRC_DIR"
     exit 0
 fi
 
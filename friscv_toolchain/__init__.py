@@ -1,4 +1,4 @@
 from .compiler import compile_riscv_tests
 from .utils import read_json
 from .vivado_interface import get_vivado_version
-from .spike_interface import get_spike_installed, SpikeInterface
\ No newline at end of file
+from .spike_interface import get_spike_installed, find_spike, SpikeInterface
\ No newline at end of file
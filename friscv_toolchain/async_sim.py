@@ -0,0 +1,232 @@
+import asyncio
+from collections import deque
+from typing import Callable
+
+from .line_buffer import DEFAULT_BUFFER_BYTES, AsyncLineBuffer
+from .runner import ResultBuilder, TestResult
+from .spike_interface import CommitParser, spike_command
+from .state import State
+
+
+# Longest line a stream reader accepts
+DEFAULT_STREAM_LIMIT = 64 * 1024
+STDERR_TAIL = 50
+
+
+class AsyncCommitProcess:
+    """
+    A simulator process whose commit log (Spike --log-commits format) is read
+    with asyncio streams, so one event loop can drive many of them.
+
+    Interactive simulators (Spike -d) are stepped with a debug command per
+    commit; others stream their log and are throttled by backpressure alone.
+    Both pipes feed a byte-budgeted AsyncLineBuffer: once the consumer falls
+    behind, the readers stop reading, the OS pipe fills and the simulator
+    blocks on write.
+
+    Usage:
+        await sim.start()
+        async for state in sim:
+            ...
+        await sim.stop()
+    """
+    def __init__(self, command: list[str], elf_path: str, step_command: str | None = None,
+                 verbose: bool = False, stream_limit: int = DEFAULT_STREAM_LIMIT,
+                 buffer_bytes: int = DEFAULT_BUFFER_BYTES) -> None:
+        self.command = command
+        self.elf_path = elf_path
+        self.step_command = step_command
+        self.verbose = verbose
+        self.stream_limit = stream_limit
+        self.buffer_bytes = buffer_bytes
+        self.proc: asyncio.subprocess.Process | None = None
+        self.stderr_tail: deque[str] = deque(maxlen=STDERR_TAIL)
+        self._lines = AsyncLineBuffer(buffer_bytes)
+        self._readers: list[asyncio.Task] = []
+        self._parser = CommitParser()
+        self._closed_pipes = 0
+        self._eof = False
+
+
+    async def start(self) -> None:
+        if self.verbose:
+            print(f'Starting {" ".join(self.command)}')
+        self._parser = CommitParser()
+        self._lines = AsyncLineBuffer(self.buffer_bytes)
+        self._closed_pipes = 0
+        self._eof = False
+        self.proc = await asyncio.create_subprocess_exec(
+            *self.command,
+            stdin=asyncio.subprocess.PIPE if self.step_command else asyncio.subprocess.DEVNULL,
+            stdout=asyncio.subprocess.PIPE,
+            stderr=asyncio.subprocess.PIPE,
+            limit=self.stream_limit
+        )
+        self._readers = [asyncio.create_task(self._read(self.proc.stdout, 'stdout')),
+                         asyncio.create_task(self._read(self.proc.stderr, 'stderr'))]
+        await self._step()
+
+
+    async def _read(self, stream: asyncio.StreamReader, source: str) -> None:
+        """Move lines from one pipe to the line buffer, waiting while it is full"""
+        while True:
+            raw = await stream.readline()
+            if not raw:
+                break
+            line = raw.decode(errors='replace').strip()
+            if not line:
+                continue
+            if self.verbose:
+                print(f'{source.upper()}: {line}')
+            if source == 'stderr':
+                self.stderr_tail.append(line)
+            await self._lines.put((source, line))
+        await self._lines.put((source, None))
+
+
+    async def _step(self) -> None:
+        if self.step_command and self.proc and self.proc.stdin and not self.proc.stdin.is_closing():
+            self.proc.stdin.write(f'{self.step_command}\n'.encode())
+            try:
+                await self.proc.stdin.drain()
+            except (BrokenPipeError, ConnectionResetError):
+                pass
+
+
+    async def next_commit(self, timeout: float | None = None) -> State | None:
+        """The next committed instruction, or None once the simulator stopped or timed out"""
+        if self._eof:
+            return None
+        await self._step()
+        while True:
+            try:
+                _, line = await asyncio.wait_for(self._lines.get(), timeout)
+            except asyncio.TimeoutError:
+                return None
+            if line is None:
+                # Both pipes closed: the commit still in flight is complete and nothing follows it
+                self._closed_pipes += 1
+                if self._closed_pipes == len(self._readers):
+                    self._eof = True
+                    state, self._parser.pending = self._parser.pending, None
+                    return state
+                continue
+            state = self._parser.feed(line)
+            if state is not None:
+                return state
+
+
+    def __aiter__(self) -> 'AsyncCommitProcess':
+        return self
+
+
+    async def __anext__(self) -> State:
+        state = await self.next_commit()
+        if state is None:
+            raise StopAsyncIteration
+        return state
+
+
+    def buffer_stats(self) -> dict:
+        return self._lines.stats()
+
+
+    async def stop(self) -> None:
+        if self.proc is None:
+            return
+        if self.proc.returncode is None:
+            self.proc.terminate()
+        for reader in self._readers:
+            reader.cancel()
+        await asyncio.gather(*self._readers, return_exceptions=True)
+        await self.proc.wait()
+        self.proc = None
+
+
+class AsyncSpikeInterface(AsyncCommitProcess):
+    """
+    Spike in debug mode, stepped one commit at a time like SpikeInterface.
+    """
+    def __init__(self, spike_path: str, isa: str, base_opts: str, start_pc: str, elf_path: str,
+                 verbose: bool = False, stream_limit: int = DEFAULT_STREAM_LIMIT,
+                 buffer_bytes: int = DEFAULT_BUFFER_BYTES) -> None:
+        super().__init__(spike_command(spike_path, isa, base_opts, start_pc, elf_path), elf_path,
+                         step_command='run 1', verbose=verbose, stream_limit=stream_limit, buffer_bytes=buffer_bytes)
+
+
+class SyncSimulator:
+    """
+    The synchronous start/next_commit/stop interface over an async simulator,
+    for run_test, compare_run and other existing callers. Each instance runs
+    its own event loop.
+    """
+    def __init__(self, sim: AsyncCommitProcess) -> None:
+        self.sim = sim
+        self.elf_path = sim.elf_path
+        self._loop = asyncio.new_event_loop()
+
+
+    def start(self) -> None:
+        self._loop.run_until_complete(self.sim.start())
+
+
+    def next_commit(self, timeout=None) -> State | None:
+        return self._loop.run_until_complete(self.sim.next_commit(timeout))
+
+
+    def stop(self) -> None:
+        if not self._loop.is_closed():
+            self._loop.run_until_complete(self.sim.stop())
+            self._loop.close()
+
+
+async def run_test_async(
+    sim: AsyncCommitProcess,
+    max_cycles: int | None = None,
+    timeout: float | None = None,
+    on_commit: Callable[[int, State], None] | None = None,
+    commit_timeout: float = 5,
+    cancel: asyncio.Event | None = None
+) -> TestResult:
+    """
+    run_test for an async simulator: run until the test writes TEST_RESULT,
+    the budget runs out or the simulator stops.
+    """
+    builder = ResultBuilder(sim.elf_path, max_cycles, timeout)
+    try:
+        await sim.start()
+        while not builder.out_of_budget(cancel is not None and cancel.is_set()):
+            state = await sim.next_commit(timeout=commit_timeout)
+            if state is None:
+                builder.stopped()
+                break
+            if on_commit:
+                on_commit(builder.result.instret, state)
+            if builder.add(state):
+                break
+    except Exception as e:
+        builder.failed(e)
+    finally:
+        await sim.stop()
+    return builder.finish()
+
+
+async def run_many(sims: list[AsyncCommitProcess], jobs: int | None = None, **kwargs) -> list[TestResult]:
+    """
+    Run every simulator to completion from this event loop, at most jobs at a time.
+
+    Args:
+        sims: Unstarted simulators, one per test
+        jobs: Concurrency limit (default: all at once)
+        kwargs: Passed to run_test_async
+
+    Returns:
+        Results in the order of sims
+    """
+    limit = asyncio.Semaphore(jobs or len(sims) or 1)
+
+    async def run(sim: AsyncCommitProcess) -> TestResult:
+        async with limit:
+            return await run_test_async(sim, **kwargs)
+
+    return await asyncio.gather(*(run(sim) for sim in sims))
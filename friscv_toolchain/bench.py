@@ -0,0 +1,264 @@
+import argparse
+import contextlib
+import io
+import json
+import os
+import random
+import stat
+import sys
+import tempfile
+import time
+from concurrent.futures import ProcessPoolExecutor
+from pathlib import Path
+
+from .comparator import compare_run
+from .decoder import disassemble, encode
+from .isa_tables import GENERATOR_OPCODES
+from .perf_gate import Metric, metrics_document, save_metrics
+from .spike_interface import CommitParser, SpikeInterface
+from .state import State
+
+
+# Mnemonics the generator draws from by commit kind: register writes, stores and the rest
+_REG_OPCODES = [(name, fmt) for name, fmt in GENERATOR_OPCODES if fmt in ('R', 'I', 'SH', 'L', 'U')]
+_STORE_OPCODES = [(name, fmt) for name, fmt in GENERATOR_OPCODES if fmt == 'S']
+_OTHER_OPCODES = [(name, fmt) for name, fmt in GENERATOR_OPCODES if fmt not in ('R', 'I', 'SH', 'L', 'U', 'S')]
+
+# Immediate range (low, high, step) of each format
+_IMM_RANGES = {
+    'I': (-2048, 2048, 1), 'L': (-2048, 2048, 1), 'S': (-2048, 2048, 1), 'SH': (0, 32, 1),
+    'B': (-4096, 4096, 2), 'U': (0, 1 << 20, 1), 'J': (-(1 << 20), 1 << 20, 2),
+}
+
+
+def _random_inst(rng: random.Random, opcodes: list[tuple[str, str]]) -> int:
+    name, fmt = rng.choice(opcodes)
+    low, high, step = _IMM_RANGES.get(fmt, (0, 1, 1))
+    return encode(name, rd=rng.randrange(1, 32), rs1=rng.randrange(32), rs2=rng.randrange(32),
+                  imm=rng.randrange(low, high, step))
+
+
+def synthetic_log(commits: int, reg_density: float = 0.7, store_density: float = 0.1,
+                  seed: int = 0) -> list[str]:
+    """
+    Generate Spike --log-commits output in the line format SpikeInterface parses.
+
+    Args:
+        commits: Number of committed instructions
+        reg_density: Fraction of commits that write a register
+        store_density: Fraction of commits that store to memory
+        seed: Random seed, so runs are repeatable
+
+    Returns:
+        Output lines, one commit line followed by its register and store lines
+    """
+    rng = random.Random(seed)
+    lines = []
+    pc = 0x80000000
+    for _ in range(commits):
+        kind = rng.random()
+        if kind < store_density:
+            inst = _random_inst(rng, _STORE_OPCODES)
+        elif kind < store_density + reg_density:
+            inst = _random_inst(rng, _REG_OPCODES)
+        else:
+            inst = _random_inst(rng, _OTHER_OPCODES)
+
+        lines.append(f'core   0: {pc:#010x} ({inst:#010x}) {disassemble(inst)}')
+        if kind < store_density:
+            lines.append(f'store: addr={0x80008000 + rng.randrange(0, 0x1000, 4):#010x} '
+                         f'data={rng.getrandbits(32):#010x}')
+        elif kind < store_density + reg_density:
+            lines.append(f'x{(inst >> 7) & 0x1F} = {rng.getrandbits(32):#010x}')
+        pc = 0x80000000 + (pc + 4 - 0x80000000) % 0x4000
+    return lines
+
+
+def group_commits(lines: list[str]) -> list[list[str]]:
+    """Split a log into the lines Spike prints for each 'run 1' debug command"""
+    groups = []
+    for line in lines:
+        if line.startswith('core'):
+            groups.append([])
+        if groups:
+            groups[-1].append(line)
+    return groups
+
+
+def parse_states(groups: list[list[str]]) -> list[State]:
+    """
+    Run commit line groups through SpikeInterface's parser without a Spike process.
+
+    The parser holds back the last commit until it sees the next one, so the
+    result has one state fewer than there are groups.
+    """
+    parser = CommitParser()
+    states = []
+    for group in groups:
+        for line in group:
+            state = parser.feed(line)
+            if state is not None:
+                states.append(state)
+    return states
+
+
+class ReplaySim:
+    """
+    Simulator stand-in that replays already parsed states.
+    """
+    def __init__(self, states: list[State], elf_path: str = 'synthetic.elf') -> None:
+        self.states = states
+        self.elf_path = elf_path
+        self._next = 0
+
+
+    def start(self) -> None:
+        self._next = 0
+
+
+    def next_commit(self, timeout=None) -> State | None:
+        if self._next >= len(self.states):
+            return None
+        self._next += 1
+        return self.states[self._next - 1]
+
+
+    def stop(self) -> None:
+        pass
+
+
+def bench_parser(groups: list[list[str]]) -> float:
+    """Parser throughput in lines/sec"""
+    started = time.perf_counter()
+    parse_states(groups)
+    return sum(map(len, groups)) / (time.perf_counter() - started)
+
+
+def bench_comparator(states: list[State]) -> float:
+    """Lockstep comparison throughput in commits/sec"""
+    reference, dut = ReplaySim(states), ReplaySim(list(states))
+    started = time.perf_counter()
+    compare_run(reference, dut)
+    return len(states) / (time.perf_counter() - started)
+
+
+_STAND_IN = """#!/bin/sh
+# Answers every debug command with one commit, like spike -d --log-commits
+pc=0
+while read -r cmd; do
+    echo "core   0: 0x8000$pc (0x00000013) nop"
+    pc=$(( (pc + 4) % 1000 ))
+done
+"""
+
+
+def bench_startup(stand_in: Path) -> float:
+    """Seconds from starting a SpikeInterface to its first parsed commit"""
+    spike = SpikeInterface(str(stand_in), 'RV32I', '', '0x80000000', 'synthetic.elf')
+    started = time.perf_counter()
+    with contextlib.redirect_stdout(io.StringIO()):
+        spike.start()
+        state = spike.next_commit(timeout=5)
+        elapsed = time.perf_counter() - started
+        spike.stop()
+    if state is None:
+        raise RuntimeError('Stand-in simulator produced no commit')
+    return elapsed
+
+
+def _parse_worker(commits: int, reg_density: float, store_density: float, seed: int) -> tuple[int, float]:
+    groups = group_commits(synthetic_log(commits, reg_density, store_density, seed))
+    started = time.perf_counter()
+    parsed = len(parse_states(groups))
+    return parsed, time.perf_counter() - started
+
+
+def bench_concurrency(instances: int, commits: int, reg_density: float, store_density: float) -> float:
+    """
+    Aggregate parsed commits/sec of instances parsers running in separate processes.
+
+    Each worker generates its log before timing its parse; the aggregate is the
+    total parsed commits over the slowest worker's parse time.
+    """
+    with ProcessPoolExecutor(max_workers=instances) as pool:
+        results = list(pool.map(_parse_worker, [commits] * instances, [reg_density] * instances,
+                                [store_density] * instances, range(instances)))
+    return sum(parsed for parsed, _ in results) / max(seconds for _, seconds in results)
+
+
+def run_benchmarks(
+    commits: int = 100000,
+    reg_density: float = 0.7,
+    store_density: float = 0.1,
+    samples: int = 5,
+    max_instances: int = 1
+) -> dict[str, Metric]:
+    """
+    Measure the toolchain on synthetic commit logs.
+
+    Args:
+        commits: Commits per synthetic log
+        reg_density: Fraction of commits writing a register
+        store_density: Fraction of commits storing to memory
+        samples: Repetitions of every measurement
+        max_instances: Measure aggregate throughput with 1..max_instances processes
+
+    Returns:
+        Metrics in the regression gate's format
+    """
+    groups = group_commits(synthetic_log(commits, reg_density, store_density))
+    states = parse_states(groups)
+
+    metrics = {
+        'parser.lines_per_sec': Metric('parser.lines_per_sec', [], 'higher', 'lines/s', True),
+        'comparator.commits_per_sec': Metric('comparator.commits_per_sec', [], 'higher', 'commits/s', True),
+        'startup.latency_ms': Metric('startup.latency_ms', [], 'lower', 'ms', True),
+    }
+    for n in range(1, max_instances + 1):
+        metrics[f'concurrency.{n}.commits_per_sec'] = \
+            Metric(f'concurrency.{n}.commits_per_sec', [], 'higher', 'commits/s', True)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        stand_in = Path(tmp) / 'spike'
+        stand_in.write_text(_STAND_IN)
+        stand_in.chmod(stand_in.stat().st_mode | stat.S_IXUSR)
+
+        for i in range(samples):
+            print(f'Sample {i + 1}/{samples}', file=sys.stderr)
+            metrics['parser.lines_per_sec'].samples.append(bench_parser(groups))
+            metrics['comparator.commits_per_sec'].samples.append(bench_comparator(states))
+            metrics['startup.latency_ms'].samples.append(bench_startup(stand_in) * 1000)
+            for n in range(1, max_instances + 1):
+                metrics[f'concurrency.{n}.commits_per_sec'].samples.append(
+                    bench_concurrency(n, commits, reg_density, store_density))
+    return metrics
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description='Benchmark the toolchain on synthetic Spike logs (no Spike, Vivado or compiler needed)'
+    )
+    parser.add_argument('--commits', type=int, default=100000, help='Commits per synthetic log')
+    parser.add_argument('--reg-density', type=float, default=0.7, help='Fraction of commits writing a register')
+    parser.add_argument('--store-density', type=float, default=0.1, help='Fraction of commits storing to memory')
+    parser.add_argument('--samples', type=int, default=5, help='Repetitions of every measurement')
+    parser.add_argument('--instances', type=int, default=1,
+                        help=f'Measure aggregate throughput with 1..N processes (this host has {os.cpu_count()} CPUs)')
+    parser.add_argument('--output', type=Path, help='Write the metrics JSON here instead of stdout')
+    args = parser.parse_args()
+
+    if args.reg_density + args.store_density > 1:
+        parser.error('--reg-density plus --store-density must not exceed 1')
+
+    metrics = run_benchmarks(args.commits, args.reg_density, args.store_density, args.samples, args.instances)
+    for name, metric in metrics.items():
+        print(f'{name:36} median {metric.median:>14.1f} {metric.unit}', file=sys.stderr)
+
+    if args.output:
+        save_metrics(metrics, args.output)
+    else:
+        print(json.dumps(metrics_document(metrics), indent=2))
+
+
+if __name__ == '__main__':
+    main()
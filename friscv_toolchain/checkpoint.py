@@ -0,0 +1,198 @@
+import json
+from pathlib import Path
+
+from .decoder import ABI_NAMES
+from .fast_forward import FastForward, PAGE_SHIFT, PAGE_SIZE
+from .utils import run_bash_script
+
+
+CHECKPOINT_FORMAT = 1
+
+# The restore stub and its page data live in their own region just above the
+# 64K program image: the saved pages can cover all of RAM, more than linker.ld
+# leaves free. Restored runs need 128K of main memory (see docs/usage.md).
+RESTORE_BASE = 0x80010000
+RESTORE_SPIKE_OPTS = '-m0x80000000:0x20000,0x20000000:0x1000'
+
+
+class Checkpoint:
+    """
+    Architectural state at a point in a program: PC, integer registers and
+    the memory pages written since reset. Clean pages come from the ELF.
+    """
+    def __init__(self, pc: int, regs: list[int], pages: dict[int, bytes],
+                 instret: int = 0, elf_path: str | None = None) -> None:
+        self.pc = pc
+        self.regs = list(regs)
+        self.pages = pages
+        self.instret = instret
+        self.elf_path = elf_path
+
+
+    @classmethod
+    def from_fast_forward(cls, engine: FastForward) -> 'Checkpoint':
+        """Capture the state of a fast-forward engine; MMIO regions are not captured"""
+        base, ram = engine.memory.region(engine.image.entry)
+        first, last = base >> PAGE_SHIFT, (base + len(ram) - 1) >> PAGE_SHIFT
+        pages = {page << PAGE_SHIFT: engine.memory.read_page(page)
+                 for page in sorted(engine.memory.dirty) if first <= page <= last}
+        return cls(engine.pc, engine.regs, pages, engine.instret, engine.image.path)
+
+
+    def save(self, path: Path | str) -> None:
+        data = {
+            'format': CHECKPOINT_FORMAT,
+            'elf': self.elf_path,
+            'instret': self.instret,
+            'pc': f'{self.pc:#010x}',
+            'regs': [f'{val:#010x}' for val in self.regs],
+            'pages': {f'{addr:#010x}': contents.hex() for addr, contents in sorted(self.pages.items())},
+        }
+        with open(path, 'w') as f:
+            json.dump(data, f, indent=2)
+
+
+    @classmethod
+    def load(cls, path: Path | str) -> 'Checkpoint':
+        with open(path, 'r') as f:
+            data = json.load(f)
+        if data.get('format') != CHECKPOINT_FORMAT:
+            raise ValueError(f'Unsupported checkpoint format in {path}: {data.get("format")}')
+        return cls(
+            pc=int(data['pc'], 0),
+            regs=[int(val, 0) for val in data['regs']],
+            pages={int(addr, 0): bytes.fromhex(contents) for addr, contents in data['pages'].items()},
+            instret=data.get('instret', 0),
+            elf_path=data.get('elf')
+        )
+
+
+def generate_restore_stub(checkpoint: Checkpoint) -> str:
+    """
+    Generate an assembly prologue that restores a checkpoint and resumes the program.
+
+    The stub copies every saved page back to its address, loads x1-x31 and
+    jumps to the saved PC with a PC-relative jal, so no register is needed
+    for the jump.
+
+    Args:
+        checkpoint: State to restore
+
+    Returns:
+        GNU assembler source for the stub, entry symbol _restore
+    """
+    lines = [
+        f'// Restore stub for {checkpoint.elf_path or "unknown ELF"} at instret {checkpoint.instret}',
+        '// Generated by friscv_toolchain.checkpoint - do not edit',
+        '.section .text.restore, "ax"',
+        '.globl _restore',
+        f'.equ _ckpt_pc, {checkpoint.pc:#010x}',
+        '',
+        '_restore:',
+        '    # Copy saved pages: each table entry is (destination, source, source end)',
+        '    la   t0, _ckpt_table',
+        '    la   t1, _ckpt_table_end',
+        '.Lnext_page:',
+        '    bgeu t0, t1, .Lregs',
+        '    lw   a0, 0(t0)',
+        '    lw   a1, 4(t0)',
+        '    lw   a2, 8(t0)',
+        '    addi t0, t0, 12',
+        '.Lcopy_word:',
+        '    lw   a3, 0(a1)',
+        '    sw   a3, 0(a0)',
+        '    addi a0, a0, 4',
+        '    addi a1, a1, 4',
+        '    bltu a1, a2, .Lcopy_word',
+        '    j    .Lnext_page',
+        '',
+        '.Lregs:',
+    ]
+    for reg in range(1, 32):
+        lines.append(f'    li   x{reg}, {checkpoint.regs[reg]:#010x}'.ljust(32) + f'# {ABI_NAMES[reg]}')
+    lines += [
+        '    j    _ckpt_pc',
+        '',
+        '    .align 2',
+        '_ckpt_table:',
+    ]
+    for i, addr in enumerate(sorted(checkpoint.pages)):
+        lines.append(f'    .word {addr:#010x}, _ckpt_page{i}, _ckpt_page{i} + {PAGE_SIZE:#x}')
+    lines.append('_ckpt_table_end:')
+    for i, addr in enumerate(sorted(checkpoint.pages)):
+        contents = checkpoint.pages[addr]
+        lines.append(f'_ckpt_page{i}:')
+        for off in range(0, PAGE_SIZE, 32):
+            words = [int.from_bytes(contents[off + j:off + j + 4], 'little') for j in range(0, 32, 4)]
+            lines.append('    .word ' + ', '.join(f'{w:#010x}' for w in words))
+
+    return '\n'.join(lines) + '\n'
+
+
+def build_restore_elf(
+    checkpoint: Checkpoint,
+    elf_path: Path,
+    output_dir: Path,
+    riscv_tools_path: Path | str | None = None
+) -> Path | None:
+    """
+    Write the restore stub for a checkpoint and link it with the program image.
+
+    Args:
+        checkpoint: State to restore
+        elf_path: ELF the checkpoint was taken from
+        output_dir: Directory for the stub source, restore ELF and HEX
+        riscv_tools_path: Optional path to the RISC-V toolchain
+
+    Returns:
+        Path of the restore ELF (entry RESTORE_BASE), or None if the build failed
+    """
+    output_dir.mkdir(parents=True, exist_ok=True)
+    name = f'{elf_path.stem}_at{checkpoint.instret}'
+    stub_path = output_dir / f'{name}_restore.S'
+    restore_elf = output_dir / f'{name}.elf'
+    stub_path.write_text(generate_restore_stub(checkpoint))
+
+    script_env_overrides = {}
+    if riscv_tools_path:
+        script_env_overrides['RISCV'] = str(Path(riscv_tools_path).resolve())
+
+    build_script_path = Path(__file__).parent.parent / 'build_scripts' / 'build-restore.sh'
+    success, _, _ = run_bash_script(build_script_path, elf_path, stub_path, restore_elf, env=script_env_overrides)
+    return restore_elf if success else None
+
+
+def create_restore_point(
+    elf_path: Path,
+    output_dir: Path,
+    max_insts: int | None = None,
+    until_pc: int | None = None,
+    riscv_tools_path: Path | str | None = None
+) -> tuple[Checkpoint, Path] | None:
+    """
+    Fast-forward a program, save a checkpoint and build its restore ELF.
+
+    Args:
+        elf_path: Program to fast-forward
+        output_dir: Directory for the checkpoint and restore files
+        max_insts: Instruction count to fast-forward
+        until_pc: PC to fast-forward to
+        riscv_tools_path: Optional path to the RISC-V toolchain
+
+    Returns:
+        (checkpoint, restore ELF path), or None on failure
+    """
+    engine = FastForward(str(elf_path))
+    engine.run(max_insts=max_insts, until_pc=until_pc)
+    print(f'Fast-forwarded {elf_path.name} by {engine.instret} instructions to PC {engine.pc:#x}'
+          + (f' ({engine.halt_reason})' if engine.halted else ''))
+
+    checkpoint = Checkpoint.from_fast_forward(engine)
+    output_dir.mkdir(parents=True, exist_ok=True)
+    checkpoint.save(output_dir / f'{elf_path.stem}_at{checkpoint.instret}.ckpt.json')
+
+    restore_elf = build_restore_elf(checkpoint, elf_path, output_dir, riscv_tools_path)
+    if restore_elf is None:
+        print(f'Failed to build restore image for {elf_path.name}')
+        return None
+    return checkpoint, restore_elf
@@ -0,0 +1,73 @@
+import re
+from pathlib import Path
+
+
+# Results block written by report_result() in rv32i-tests.h, just before TEST_RESULT
+CHECK_BLOCK_ADDR = 0x20000004
+CHECKS_MAGIC = 0x314B4843
+CHECK_FIELDS = ('magic', 'checks', 'failures', 'first_id', 'expected', 'actual')
+
+# CHECK/CHECK_EQ in C tests, TEST_* macros of rv32i-asm-tests.h in assembly tests
+CHECK_RE = re.compile(r'\b(?:CHECK(?:_EQ)?|TEST_[A-Z0-9_]+)\s*\(\s*(?P<id>0[xX][0-9a-fA-F]+|\d+)\s*,')
+
+
+class CheckReport:
+    """
+    Decoded results block: how many checks ran and the first one that failed.
+    """
+    def __init__(self, checks: int, failures: int, first_id: int, expected: int, actual: int) -> None:
+        self.checks = checks
+        self.failures = failures
+        self.first_id = first_id
+        self.expected = expected
+        self.actual = actual
+
+
+    def __str__(self) -> str:
+        if not self.failures:
+            return f'{self.checks} checks passed'
+        return (f'check {self.first_id} failed: expected {self.expected:#x}, got {self.actual:#x} '
+                f'({self.failures} of {self.checks} checks failed)')
+
+
+def is_check_store(addr: int) -> bool:
+    return CHECK_BLOCK_ADDR <= addr < CHECK_BLOCK_ADDR + 4 * len(CHECK_FIELDS)
+
+
+def decode_checks(words: dict[int, int]) -> CheckReport | None:
+    """
+    Build a report from the words stored into the results block.
+
+    Args:
+        words: Last value written to each block address
+
+    Returns:
+        The report, or None if the test did not write a valid block (no CHECK macros in use)
+    """
+    fields = {name: words.get(CHECK_BLOCK_ADDR + 4 * i) for i, name in enumerate(CHECK_FIELDS)}
+    if fields.pop('magic') != CHECKS_MAGIC or None in fields.values():
+        return None
+    return CheckReport(**fields)
+
+
+def find_check(source: Path | str, check_id: int) -> tuple[int, str] | None:
+    """(line number, source line) of the CHECK with this ID in a test source"""
+    try:
+        lines = Path(source).read_text(errors='replace').splitlines()
+    except OSError:
+        return None
+    for number, line in enumerate(lines, 1):
+        for m in CHECK_RE.finditer(line):
+            if int(m.group('id'), 0) == check_id:
+                return number, line.strip()
+    return None
+
+
+def describe_failure(report: CheckReport, source: Path | str | None = None) -> str:
+    """The report, naming the failing check's source line when the source is at hand"""
+    text = str(report)
+    if report.failures and source is not None:
+        found = find_check(source, report.first_id)
+        if found:
+            text += f'\n  at {Path(source).name}:{found[0]}: {found[1]}'
+    return text
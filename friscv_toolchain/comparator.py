@@ -1,35 +1,147 @@
 
 
-from friscv_toolchain.vivado_interface import VivadoInterface
-from friscv_toolchain.spike_interface import SpikeInterface
+import asyncio
+from collections import deque
+from pathlib import Path
 
+from friscv_toolchain.state import State
+from friscv_toolchain.trace import TraceWriter
 
-def compare_run():
-    spike = SpikeInterface(
-        spike_path='spike',
-        isa='rv32i',
-        base_opts='-m0x80000000:0x10000,0x20000000:0x1000',
-        start_pc='0x80000000',
-        elf_path='./output/bin/test1_alu.elf'
-    )
 
-    vivado = VivadoInterface(
-        sim_cmd='vsim -c -do run.do'
-    )
+# Reference commits kept before a divergence for triage signatures
+HISTORY_LENGTH = 8
 
-    spike.start()
+
+class Mismatch:
+    """
+    First divergence between a reference and a DUT commit stream.
+    """
+    def __init__(self, index: int, expected: State, actual: State | None, fields: list[tuple[str, str, str]],
+                 history: list[State] | None = None) -> None:
+        self.index = index
+        self.expected = expected
+        self.actual = actual
+        self.fields = fields
+        self.history = history if history is not None else []
+
+
+    def __str__(self) -> str:
+        lines = [f'Mismatch detected at commit {self.index}, PC {self.expected.pc:#010x} '
+                 f'({self.expected.inst:#010x} {self.expected.disasm})']
+        for field, expected, actual in self.fields:
+            lines.append(f'  {field}: expected {expected}, got {actual}')
+        return '\n'.join(lines)
+
+
+def _hex(value: int | None) -> str:
+    return f'{value:#010x}' if value is not None else 'None'
+
+
+def _stores(stores: list[tuple[int, int]]) -> str:
+    return '[' + ', '.join(f'({addr:#010x}, {data:#010x})' for addr, data in stores) + ']'
+
+
+def compare_states(expected: State, actual: State) -> list[tuple[str, str, str]]:
+    """
+    Compare one committed instruction of two simulators.
+
+    Returns:
+        (field, expected, actual) for every differing field: pc, x<N> or store,
+        with the values as hex text
+    """
+    fields = []
+    if expected.pc != actual.pc:
+        fields.append(('pc', _hex(expected.pc), _hex(actual.pc)))
+    if expected.regs != actual.regs:
+        for reg in sorted(set(expected.regs) | set(actual.regs)):
+            exp, act = expected.regs.get(reg), actual.regs.get(reg)
+            if exp is None or act is None or exp != act:
+                fields.append((f'x{reg}', _hex(exp), _hex(act)))
+    if expected.stores != actual.stores:
+        fields.append(('store', _stores(expected.stores), _stores(actual.stores)))
+    return fields
+
+
+def _diverged(index: int, spike_state: State, dut_state: State | None, history: deque,
+              trace_path: Path | None) -> Mismatch | None:
+    """Compare one pair of commits and report the Mismatch if they differ"""
+    fields = compare_states(spike_state, dut_state) if dut_state else [('commit', 'commit', 'none')]
+    if not fields:
+        return None
+    mismatch = Mismatch(index, spike_state, dut_state, fields, list(history))
+    print(mismatch)
+    reg = next((f for f, _, _ in fields if f.startswith('x')), None)
+    if trace_path and reg:
+        print(f'Slice with: python3 -m friscv_toolchain.slicer {trace_path} --index {index} --reg {reg}')
+    return mismatch
+
+
+def compare_run(reference, dut, trace_path: Path | None = None, timeout: float = 1) -> Mismatch | None:
+    """
+    Step a reference simulator and a DUT in lockstep until they diverge.
+
+    Args:
+        reference: Golden model with start/next_commit/stop (e.g. SpikeInterface)
+        dut: Design under test with the same interface
+        trace_path: If given, the reference commits are written there for later slicing
+        timeout: Seconds to wait for each commit
+
+    Returns:
+        The first Mismatch, or None if the streams matched until the reference ended
+    """
+    trace = TraceWriter(trace_path) if trace_path else None
+    reference.start()
+    dut.start()
+
+    try:
+        index = 0
+        history = deque(maxlen=HISTORY_LENGTH)
+        while True:
+            spike_state = reference.next_commit(timeout=timeout)
+            if spike_state is None:
+                return None
+            if trace:
+                trace.append(spike_state)
+            dut_state = dut.next_commit(timeout=timeout)
+            mismatch = _diverged(index, spike_state, dut_state, history, trace_path)
+            if mismatch:
+                return mismatch
+            history.append(spike_state)
+            index += 1
+    finally:
+        if trace:
+            trace.close()
+        reference.stop()
+        dut.stop()
+
+
+async def compare_run_async(reference, dut, trace_path: Path | None = None, timeout: float = 1) -> Mismatch | None:
+    """
+    compare_run for simulators with the async interface of async_sim: both are
+    started, stepped and stopped concurrently, so a slow DUT and the reference
+    overlap instead of taking turns.
+
+    Returns:
+        The first Mismatch, or None if the streams matched until the reference ended
+    """
+    trace = TraceWriter(trace_path) if trace_path else None
+    await asyncio.gather(reference.start(), dut.start())
 
     try:
+        index = 0
+        history = deque(maxlen=HISTORY_LENGTH)
         while True:
-            spike_state = spike.next_commit(timeout=1)
+            spike_state, dut_state = await asyncio.gather(reference.next_commit(timeout), dut.next_commit(timeout))
             if spike_state is None:
-                break
-            vivado_state = vivado.step_cycle()
-            if spike_state['regs'] != vivado_state.get('regs') or spike_state['stores'] != vivado_state.get('stores'):
-                print(f'Mismatch detected at PC {spike_state['pc']}')
-                print(f'Spike state: {spike_state}')
-                print(f'Vivado state: {vivado_state}')
-                break
+                return None
+            if trace:
+                trace.append(spike_state)
+            mismatch = _diverged(index, spike_state, dut_state, history, trace_path)
+            if mismatch:
+                return mismatch
+            history.append(spike_state)
+            index += 1
     finally:
-        spike.stop()
-        vivado.stop()
+        if trace:
+            trace.close()
+        await asyncio.gather(reference.stop(), dut.stop())
@@ -8,7 +8,11 @@ def compile_riscv_tests(
     bash_script_path: Path,
     test_src_dir: Path,
     output_base_dir: Path,
-    riscv_tools_path: Path | str | None = None
+    riscv_tools_path: Path | str | None = None,
+    tests: list[Path | str] | None = None,
+    runtime: bool = True,
+    cflags: list[str] | None = None,
+    layout_dir: Path | None = None
 ) -> bool:
     """
     Compiles RISC-V tests using the provided bash script.
@@ -17,6 +21,10 @@ def compile_riscv_tests(
         test_src_dir: Directory containing the C test files.
         output_base_dir: Directory where the bash script will store compiled outputs (bin, hex, disasm).
         riscv_tools_path: Optional path to the RISC-V toolchain.
+        tests: Optional subset of test sources to build; all tests when None.
+        runtime: Link build_scripts/runtime.S; False links the libgcc helpers instead.
+        cflags: Extra compiler flags (e.g. ['-ffunction-sections']).
+        layout_dir: Directory of per-test linker scripts (<test>.ld) to use instead of linker.ld.
     Returns:
         True if the compilation script ran successfully (exit code 0), False otherwise.
     """
@@ -34,11 +42,18 @@ def compile_riscv_tests(
             print(f"Using existing RISCV_PATH from environment: {os.environ['RISCV_PATH']}")
         else:
             print("RISCV_PATH not provided and not in environment. Bash script will use its default ($HOME/riscv32).")
+    if not runtime:
+        script_env_overrides["USE_RUNTIME"] = "0"
+    if cflags:
+        script_env_overrides["EXTRA_CFLAGS"] = " ".join(cflags)
+    if layout_dir:
+        script_env_overrides["LAYOUT_DIR"] = str(Path(layout_dir).resolve())
 
     success, _, _ = run_bash_script(
         bash_script_path,
         str(test_src_dir.resolve()),
         str(output_base_dir.resolve()),
+        *[str(Path(test).resolve()) for test in tests or []],
         env=script_env_overrides
     )
 
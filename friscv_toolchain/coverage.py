@@ -0,0 +1,101 @@
+import argparse
+import json
+from pathlib import Path
+
+from .decoder import Decoded, decode
+from .isa_tables import COVERAGE_BINS
+from .trace import RECORD_WORDS, TraceReader
+
+
+# What each coverage bin requires of a commit: the decoded instruction and
+# whether it redirected control flow (None when the next commit is unknown)
+BIN_TESTS = {
+    'executed':  lambda d, taken: True,
+    'rd=zero':   lambda d, taken: d.rd == 0,
+    'rd=ra':     lambda d, taken: d.rd == 1,
+    'rd=rs1':    lambda d, taken: d.rd == d.rs1,
+    'rs1=rs2':   lambda d, taken: d.rs1 == d.rs2,
+    'imm<0':     lambda d, taken: d.imm < 0,
+    'imm=0':     lambda d, taken: d.imm == 0,
+    'imm>0':     lambda d, taken: d.imm > 0,
+    'offset<0':  lambda d, taken: d.imm < 0,
+    'offset=0':  lambda d, taken: d.imm == 0,
+    'offset>0':  lambda d, taken: d.imm > 0,
+    'shamt=0':   lambda d, taken: d.imm == 0,
+    'shamt=31':  lambda d, taken: d.imm == 31,
+    'taken':     lambda d, taken: taken is True,
+    'not-taken': lambda d, taken: taken is False,
+    'backward':  lambda d, taken: d.imm < 0,
+}
+
+
+class Coverage:
+    """
+    Hits of the instruction coverage bins generated from the ISA tables
+    (COVERAGE_BINS), accumulated over any number of traces.
+    """
+    def __init__(self) -> None:
+        self.hits: dict[tuple[str, str], int] = {(name, b): 0 for name, bins in COVERAGE_BINS.items() for b in bins}
+        self.unknown = 0
+
+
+    def add(self, inst: int, taken: bool | None = None) -> None:
+        decoded: Decoded | None = decode(inst)
+        if decoded is None:
+            self.unknown += 1
+            return
+        for b in COVERAGE_BINS[decoded.name]:
+            if BIN_TESTS[b](decoded, taken):
+                self.hits[(decoded.name, b)] += 1
+
+
+    def add_trace(self, reader: TraceReader) -> None:
+        """Count every commit of a trace; a commit is taken if the next one is not at pc + 4"""
+        words = reader.words
+        for i in range(len(reader)):
+            base = i * RECORD_WORDS
+            following = base + RECORD_WORDS
+            taken = words[following] != (words[base] + 4) & 0xFFFFFFFF if i + 1 < len(reader) else None
+            self.add(words[base + 1], taken)
+
+
+    def missing(self) -> dict[str, list[str]]:
+        missing: dict[str, list[str]] = {}
+        for (name, b), count in self.hits.items():
+            if not count:
+                missing.setdefault(name, []).append(b)
+        return missing
+
+
+    def report(self) -> str:
+        covered = sum(1 for count in self.hits.values() if count)
+        executed = sum(1 for (_, b), count in self.hits.items() if b == 'executed' and count)
+        lines = [f'{executed}/{len(COVERAGE_BINS)} instructions executed, '
+                 f'{covered}/{len(self.hits)} bins covered ({100 * covered / len(self.hits):.1f}%)']
+        if self.unknown:
+            lines.append(f'{self.unknown} commits of instructions outside the ISA tables')
+        for name, bins in self.missing().items():
+            lines.append(f'  {name:8} missing {", ".join(bins)}')
+        return '\n'.join(lines)
+
+
+    def to_json(self) -> dict:
+        return {'bins': {f'{name}/{b}': count for (name, b), count in self.hits.items()}, 'unknown': self.unknown}
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description='Instruction coverage of stored traces')
+    parser.add_argument('traces', type=Path, nargs='+', help='Trace files written with --dump-state')
+    parser.add_argument('--json', type=Path, help='Also write the hit counts of every bin here')
+    args = parser.parse_args()
+
+    coverage = Coverage()
+    for path in args.traces:
+        coverage.add_trace(TraceReader(path))
+    print(coverage.report())
+    if args.json:
+        args.json.write_text(json.dumps(coverage.to_json(), indent=2))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,370 @@
+import argparse
+import hashlib
+import json
+import os
+import socket
+import socketserver
+import sys
+import threading
+import time
+from pathlib import Path
+
+from .compiler import compile_riscv_tests
+from .elf import ElfImage, read_elf
+from .listing import Listing, find_listing, load_listing
+from .manifest import TestSpec, discover_tests, select_tests
+from .perfdb import PerfDB
+from .runner import run_test
+from .spike_interface import SpikeInterface, SPIKE_OPTS, START_PC, find_spike, get_spike_installed
+
+
+DEFAULT_SOCKET_PATH = Path('./output/friscv.sock')
+BUILD_SCRIPT_PATH = Path(__file__).parent.parent / 'build_scripts' / 'build-tests.sh'
+SPIKE_ISA = 'rv32i'
+
+
+def source_fingerprint(*dirs: Path) -> str:
+    """Cheap change detector over file names, sizes and modification times"""
+    digest = hashlib.sha256()
+    for root in dirs:
+        for path in sorted(p for p in Path(root).rglob('*') if p.is_file()):
+            st = path.stat()
+            digest.update(f'{path}:{st.st_size}:{st.st_mtime_ns}\n'.encode())
+    return digest.hexdigest()
+
+
+class WarmPool:
+    """
+    One started simulator per test ELF, waiting at its first instruction.
+
+    A simulator is handed out once and replaced in the background, so the
+    next run of the same test skips process start-up. Simulators of ELFs
+    that were rebuilt are discarded.
+    """
+    def __init__(self, spike_cmd: str) -> None:
+        self.spike_cmd = spike_cmd
+        self._ready: dict[str, tuple[int, SpikeInterface]] = {}
+        self._lock = threading.Lock()
+
+
+    def _start(self, elf_path: str) -> SpikeInterface:
+        spike = SpikeInterface(self.spike_cmd, SPIKE_ISA, SPIKE_OPTS, START_PC, elf_path, verbose=False)
+        spike.start()
+        return spike
+
+
+    def acquire(self, elf_path: str) -> SpikeInterface:
+        mtime = os.stat(elf_path).st_mtime_ns
+        with self._lock:
+            entry = self._ready.pop(elf_path, None)
+        if entry is not None:
+            ready_mtime, spike = entry
+            if ready_mtime == mtime and spike.proc and spike.proc.poll() is None:
+                return spike
+            spike.stop()
+        return self._start(elf_path)
+
+
+    def prewarm(self, elf_path: str) -> None:
+        """Start a simulator for elf_path in the background unless one is ready"""
+        def warm():
+            mtime = os.stat(elf_path).st_mtime_ns
+            with self._lock:
+                entry = self._ready.get(elf_path)
+                if entry is not None and entry[0] == mtime:
+                    return
+            spike = self._start(elf_path)
+            with self._lock:
+                old = self._ready.pop(elf_path, None)
+                self._ready[elf_path] = (mtime, spike)
+            if old is not None:
+                old[1].stop()
+
+        threading.Thread(target=warm, daemon=True).start()
+
+
+    def size(self) -> int:
+        with self._lock:
+            return len(self._ready)
+
+
+    def close(self) -> None:
+        with self._lock:
+            entries, self._ready = list(self._ready.values()), {}
+        for _, spike in entries:
+            spike.stop()
+
+
+class Daemon:
+    """
+    Long-lived state shared by all client requests: probed tools, the build
+    cache, parsed ELFs and listings, and warm simulators.
+    """
+    def __init__(
+        self,
+        test_dir: Path,
+        output_dir: Path,
+        spike_path: str | None = None,
+        riscv_tools_path: str | None = None,
+        perf_db: Path | None = None
+    ) -> None:
+        self.test_dir = Path(test_dir)
+        self.output_dir = Path(output_dir)
+        self.riscv_tools_path = riscv_tools_path
+        self.perf_db = perf_db
+
+        if not get_spike_installed(spike_path):
+            raise RuntimeError('Spike is not installed or not accessible')
+        self.pool = WarmPool(find_spike(spike_path))
+
+        self._build_lock = threading.Lock()
+        self._fingerprint: str | None = None
+        self._elf_cache: dict[str, tuple[int, ElfImage, Listing | None]] = {}
+        self.started = time.time()
+        self.requests = 0
+
+
+    def specs(self) -> dict[str, TestSpec]:
+        """Runnable tests of test_dir by name, with their manifest budgets"""
+        selected, _ = select_tests(discover_tests(self.test_dir))
+        return {spec.name: spec for spec in selected}
+
+
+    def ensure_built(self) -> tuple[bool, float]:
+        """
+        Recompile the tests if any source or build script changed since the last build.
+
+        Returns:
+            (success, seconds spent compiling; 0 when the cache was current)
+        """
+        with self._build_lock:
+            fingerprint = source_fingerprint(self.test_dir, BUILD_SCRIPT_PATH.parent)
+            if fingerprint == self._fingerprint:
+                return True, 0.0
+            specs = self.specs()
+            started = time.perf_counter()
+            success = compile_riscv_tests(BUILD_SCRIPT_PATH, self.test_dir, self.output_dir, self.riscv_tools_path,
+                                          tests=[spec.source for spec in specs.values()])
+            if success:
+                self._fingerprint = fingerprint
+                for spec in specs.values():
+                    if spec.elf_path(self.output_dir).is_file():
+                        self.pool.prewarm(str(spec.elf_path(self.output_dir)))
+            return success, time.perf_counter() - started
+
+
+    def elf_info(self, elf_path: str) -> tuple[ElfImage, Listing | None]:
+        """Parsed ELF and listing, reloaded only when the ELF changes"""
+        mtime = os.stat(elf_path).st_mtime_ns
+        cached = self._elf_cache.get(elf_path)
+        if cached is None or cached[0] != mtime:
+            lst_path = find_listing(Path(elf_path))
+            cached = (mtime, read_elf(elf_path), load_listing(lst_path) if lst_path else None)
+            self._elf_cache[elf_path] = cached
+        return cached[1], cached[2]
+
+
+    def describe_pc(self, elf_path: str, pc: int | None) -> str | None:
+        """'<function+offset> disassembly' of a PC, from the cached listing or ELF symbols"""
+        if pc is None:
+            return None
+        image, listing = self.elf_info(elf_path)
+        if listing is not None and listing.annotate(pc):
+            return f'{pc:#x} {listing.annotate(pc)}'
+        name = image.symbol_at(pc)
+        return f'{pc:#x} <{name}>' if name else f'{pc:#x}'
+
+
+    def resolve_tests(self, tests: list[str]) -> list[tuple[TestSpec, str]]:
+        """
+        Map test names (test1_alu) or ELF paths to their manifest entry and ELF;
+        no names means every test of test_dir. An ELF that is not one of the
+        tests gets the default budgets and is expected to pass.
+        """
+        specs = self.specs()
+        resolved = []
+        for test in tests or sorted(specs):
+            path = Path(test)
+            spec = specs.get(path.stem) or TestSpec(path.stem, path)
+            if not path.suffix:
+                path = spec.elf_path(self.output_dir)
+            if not path.is_file():
+                raise FileNotFoundError(f'No ELF for test {test} (looked for {path})')
+            resolved.append((spec, str(path)))
+        return resolved
+
+
+    def run(self, request: dict, send) -> None:
+        """Build if needed, run the requested tests and stream one event per result"""
+        self.requests += 1
+        success, compile_seconds = self.ensure_built()
+        send({'event': 'build', 'success': success, 'seconds': compile_seconds, 'cached': compile_seconds == 0})
+        if not success:
+            return
+
+        results = []
+        for spec, elf_path in self.resolve_tests(request.get('tests', [])):
+            spike = self.pool.acquire(elf_path)
+            result = run_test(spike, max_cycles=spec.max_cycles or request.get('max_cycles'),
+                              timeout=spec.timeout or request.get('timeout'), started=True)
+            self.pool.prewarm(elf_path)
+            results.append(result)
+
+            send({
+                'event': 'result',
+                'test': result.name,
+                'status': result.status,
+                'expect': spec.expect,
+                'instret': result.instret,
+                'cycles': result.cycles,
+                'seconds': result.phases['simulate'],
+                'message': result.message,
+                'last_pc': self.describe_pc(elf_path, result.last_pc),
+            })
+
+        if results and self.perf_db:
+            db = PerfDB(self.perf_db)
+            run_phases = {'compile': compile_seconds} if compile_seconds else {}
+            run_id = db.record_run(results, run_phases=run_phases, notes='daemon')
+            db.close()
+            send({'event': 'recorded', 'run_id': run_id})
+
+
+    def status(self) -> dict:
+        return {
+            'event': 'status',
+            'uptime': time.time() - self.started,
+            'requests': self.requests,
+            'warm_simulators': self.pool.size(),
+            'cached_elfs': len(self._elf_cache),
+            'built': self._fingerprint is not None,
+        }
+
+
+class _Handler(socketserver.StreamRequestHandler):
+    def handle(self) -> None:
+        def send(event: dict) -> None:
+            self.wfile.write((json.dumps(event) + '\n').encode())
+            self.wfile.flush()
+
+        for line in self.rfile:
+            try:
+                request = json.loads(line)
+                command = request.get('cmd')
+                if command == 'run':
+                    self.server.daemon_state.run(request, send)
+                elif command == 'status':
+                    send(self.server.daemon_state.status())
+                elif command == 'shutdown':
+                    send({'event': 'shutdown'})
+                    threading.Thread(target=self.server.shutdown, daemon=True).start()
+                else:
+                    send({'event': 'error', 'message': f'Unknown command {command}'})
+            except Exception as e:
+                send({'event': 'error', 'message': str(e)})
+            send({'event': 'done'})
+
+
+class _Server(socketserver.ThreadingMixIn, socketserver.UnixStreamServer):
+    daemon_threads = True
+
+
+def serve(daemon: Daemon, socket_path: Path) -> None:
+    socket_path.parent.mkdir(parents=True, exist_ok=True)
+    if socket_path.exists():
+        socket_path.unlink()
+    server = _Server(str(socket_path), _Handler)
+    server.daemon_state = daemon
+    print(f'Listening on {socket_path}')
+    try:
+        try:
+            success, seconds = daemon.ensure_built()
+            print(f'Initial build {"done" if success else "failed"} in {seconds:.2f}s')
+        except ValueError as e:
+            print(f'Initial build failed: {e}')
+        server.serve_forever()
+    finally:
+        server.server_close()
+        daemon.pool.close()
+        if socket_path.exists():
+            socket_path.unlink()
+
+
+def request(socket_path: Path, message: dict):
+    """Send one request to the daemon and yield its events until 'done'"""
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+        sock.connect(str(socket_path))
+        sock.sendall((json.dumps(message) + '\n').encode())
+        with sock.makefile('r') as stream:
+            for line in stream:
+                event = json.loads(line)
+                if event['event'] == 'done':
+                    return
+                yield event
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description='Resident FRISC-V test daemon and its client')
+    parser.add_argument('--socket', type=Path, default=DEFAULT_SOCKET_PATH, help='UNIX socket of the daemon')
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    serve_cmd = sub.add_parser('serve', help='Start the daemon in the foreground')
+    serve_cmd.add_argument('--test-dir', type=Path, default=Path('./test_sources/c'))
+    serve_cmd.add_argument('--output', type=Path, default=Path('./output'))
+    serve_cmd.add_argument('--spike-path')
+    serve_cmd.add_argument('--riscv-tools-path')
+    serve_cmd.add_argument('--perf-db', type=Path, help='Record every run in this performance database')
+
+    run_cmd = sub.add_parser('run', help='Run tests (all if none are named) and stream the results')
+    run_cmd.add_argument('tests', nargs='*', help='Test names (e.g. test1_alu) or ELF paths')
+    run_cmd.add_argument('--max-cycles', type=int, default=10000,
+                         help='Instruction budget of tests whose manifest sets none')
+    run_cmd.add_argument('--timeout', type=float, default=60,
+                         help='Seconds allowed to tests whose manifest sets none')
+
+    sub.add_parser('status', help='Show what the daemon holds')
+    sub.add_parser('stop', help='Shut the daemon down')
+    args = parser.parse_args()
+
+    if args.command == 'serve':
+        try:
+            daemon = Daemon(args.test_dir, args.output, args.spike_path, args.riscv_tools_path, args.perf_db)
+        except RuntimeError as e:
+            print(f'Error: {e}')
+            sys.exit(1)
+        serve(daemon, args.socket)
+        return
+
+    message = {'cmd': {'run': 'run', 'status': 'status', 'stop': 'shutdown'}[args.command]}
+    if args.command == 'run':
+        message.update(tests=args.tests, max_cycles=args.max_cycles, timeout=args.timeout)
+
+    failed = False
+    try:
+        for event in request(args.socket, message):
+            kind = event.pop('event')
+            if kind == 'result':
+                expect = event['expect']
+                failed |= event['status'] != expect
+                print(f'{event["test"]:28} {event["status"].upper():8} {event["instret"]:>8} instructions '
+                      f'{event["seconds"] * 1000:8.1f} ms  {event["message"]}'
+                      f'{"" if expect == "pass" else f" [expected {expect}]"}')
+                if event['status'] != expect and event['last_pc']:
+                    print(f'    stopped at {event["last_pc"]}')
+            elif kind == 'build':
+                print('Build: ' + ('cached' if event['cached'] else f'{event["seconds"]:.2f}s')
+                      if event['success'] else 'Build failed')
+                failed |= not event['success']
+            elif kind == 'error':
+                print(f'Error: {event["message"]}')
+                failed = True
+            else:
+                print(f'{kind}: {json.dumps(event)}')
+    except (FileNotFoundError, ConnectionRefusedError):
+        print(f'No daemon at {args.socket}; start one with: python3 -m friscv_toolchain.daemon serve')
+        sys.exit(2)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
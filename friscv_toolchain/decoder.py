@@ -0,0 +1,191 @@
+from functools import lru_cache
+
+from .isa_tables import ACCESSES, DECODE_TABLE, ENCODINGS
+
+
+ABI_NAMES = ['zero', 'ra', 'sp', 'gp', 'tp', 't0', 't1', 't2', 's0', 's1', 'a0', 'a1', 'a2', 'a3', 'a4', 'a5',
+             'a6', 'a7', 's2', 's3', 's4', 's5', 's6', 's7', 's8', 's9', 's10', 's11', 't3', 't4', 't5', 't6']
+
+# Operand fields each format has
+_HAS_RD = frozenset(('R', 'I', 'SH', 'L', 'U', 'J', 'JR'))
+_HAS_RS1 = frozenset(('R', 'I', 'SH', 'L', 'S', 'B', 'JR'))
+_HAS_RS2 = frozenset(('R', 'S', 'B'))
+
+_BY_NAME = {name: (fmt, match) for name, fmt, _, match in ENCODINGS}
+
+
+def _sext(value: int, bits: int) -> int:
+    sign = 1 << (bits - 1)
+    return (value & (sign - 1)) - (value & sign)
+
+
+def _imm(fmt: str, inst: int) -> int:
+    if fmt in ('I', 'L', 'JR'):
+        return _sext(inst >> 20, 12)
+    if fmt == 'SH':
+        return (inst >> 20) & 0x1F
+    if fmt == 'S':
+        return _sext(((inst >> 25) << 5) | ((inst >> 7) & 0x1F), 12)
+    if fmt == 'B':
+        return _sext(((inst >> 31) << 12) | (((inst >> 7) & 1) << 11) |
+                     (((inst >> 25) & 0x3F) << 5) | (((inst >> 8) & 0xF) << 1), 13)
+    if fmt == 'U':
+        return inst >> 12
+    if fmt == 'J':
+        return _sext(((inst >> 31) << 20) | (((inst >> 12) & 0xFF) << 12) |
+                     (((inst >> 20) & 1) << 11) | (((inst >> 21) & 0x3FF) << 1), 21)
+    if fmt == 'F':
+        return (inst >> 20) & 0xFF
+    return 0
+
+
+class Decoded:
+    """
+    Operand fields of one instruction. Fields the format does not have are 0.
+    """
+    __slots__ = ('name', 'fmt', 'rd', 'rs1', 'rs2', 'imm')
+
+    def __init__(self, name: str, fmt: str, rd: int, rs1: int, rs2: int, imm: int) -> None:
+        self.name = name
+        self.fmt = fmt
+        self.rd = rd
+        self.rs1 = rs1
+        self.rs2 = rs2
+        self.imm = imm
+
+
+@lru_cache(maxsize=4096)
+def decode(inst: int) -> Decoded | None:
+    """Decode an instruction word of the ISA tables (see isa_gen); None if it is not one"""
+    for name, fmt, mask, match in DECODE_TABLE.get(inst & 0x7F, ()):
+        if inst & mask == match:
+            rd = (inst >> 7) & 0x1F if fmt in _HAS_RD else 0
+            rs1 = (inst >> 15) & 0x1F if fmt in _HAS_RS1 else 0
+            rs2 = (inst >> 20) & 0x1F if fmt in _HAS_RS2 else 0
+            return Decoded(name, fmt, rd, rs1, rs2, _imm(fmt, inst))
+    return None
+
+
+def access_size(inst: int) -> int | None:
+    """Bytes a load or store accesses (see isa_tables.ACCESSES); None for other instructions"""
+    decoded = decode(inst)
+    access = ACCESSES.get(decoded.name) if decoded else None
+    return access[0] if access else None
+
+
+def encode(name: str, rd: int = 0, rs1: int = 0, rs2: int = 0, imm: int = 0) -> int:
+    """
+    Instruction word of a mnemonic with the given operands, the inverse of
+    decode. Operands the format does not have are ignored.
+
+    Raises:
+        KeyError: If the mnemonic is not in the ISA tables
+    """
+    fmt, inst = _BY_NAME[name]
+    if fmt in _HAS_RD:
+        inst |= (rd & 0x1F) << 7
+    if fmt in _HAS_RS1:
+        inst |= (rs1 & 0x1F) << 15
+    if fmt in _HAS_RS2:
+        inst |= (rs2 & 0x1F) << 20
+    if fmt in ('I', 'L', 'JR'):
+        inst |= (imm & 0xFFF) << 20
+    elif fmt == 'SH':
+        inst |= (imm & 0x1F) << 20
+    elif fmt == 'S':
+        inst |= ((imm >> 5) & 0x7F) << 25 | (imm & 0x1F) << 7
+    elif fmt == 'B':
+        inst |= (((imm >> 12) & 1) << 31 | ((imm >> 5) & 0x3F) << 25 |
+                 ((imm >> 1) & 0xF) << 8 | ((imm >> 11) & 1) << 7)
+    elif fmt == 'U':
+        inst |= (imm & 0xFFFFF) << 12
+    elif fmt == 'J':
+        inst |= (((imm >> 20) & 1) << 31 | ((imm >> 1) & 0x3FF) << 21 |
+                 ((imm >> 11) & 1) << 20 | ((imm >> 12) & 0xFF) << 12)
+    elif fmt == 'F':
+        inst |= (imm & 0xFF) << 20
+    return inst
+
+
+def _offset(imm: int) -> str:
+    return f'pc + {imm}' if imm >= 0 else f'pc - {-imm}'
+
+
+def _fence_set(bits: int) -> str:
+    return ''.join(c for c, bit in zip('iorw', (8, 4, 2, 1)) if bits & bit) or '0'
+
+
+def _operands(d: Decoded) -> tuple[str, list[str]]:
+    """Mnemonic and operands, with the pseudo-instructions Spike prints"""
+    rd, rs1, rs2 = ABI_NAMES[d.rd], ABI_NAMES[d.rs1], ABI_NAMES[d.rs2]
+    name, fmt, imm = d.name, d.fmt, d.imm
+
+    if fmt == 'R':
+        if name == 'sub' and d.rs1 == 0:
+            return 'neg', [rd, rs2]
+        if name == 'sltu' and d.rs1 == 0:
+            return 'snez', [rd, rs2]
+        if name == 'slt' and d.rs2 == 0:
+            return 'sltz', [rd, rs1]
+        if name == 'slt' and d.rs1 == 0:
+            return 'sgtz', [rd, rs2]
+        return name, [rd, rs1, rs2]
+    if fmt == 'I':
+        if name == 'addi':
+            if d.rd == 0 and d.rs1 == 0 and imm == 0:
+                return 'nop', []
+            if d.rs1 == 0:
+                return 'li', [rd, str(imm)]
+            if imm == 0:
+                return 'mv', [rd, rs1]
+        if name == 'xori' and imm == -1:
+            return 'not', [rd, rs1]
+        if name == 'sltiu' and imm == 1:
+            return 'seqz', [rd, rs1]
+        return name, [rd, rs1, str(imm)]
+    if fmt == 'SH':
+        return name, [rd, rs1, str(imm)]
+    if fmt == 'L':
+        return name, [rd, f'{imm}({rs1})']
+    if fmt == 'S':
+        return name, [rs2, f'{imm}({rs1})']
+    if fmt == 'U':
+        return name, [rd, f'0x{imm:x}']
+    if fmt == 'J':
+        if d.rd == 0:
+            return 'j', [_offset(imm)]
+        if d.rd == 1:
+            return 'jal', [_offset(imm)]
+        return name, [rd, _offset(imm)]
+    if fmt == 'JR':
+        if d.rd == 0 and d.rs1 == 1 and imm == 0:
+            return 'ret', []
+        if d.rd == 0 and imm == 0:
+            return 'jr', [rs1]
+        if d.rd == 1 and imm == 0:
+            return 'jalr', [rs1]
+        return name, [rd, f'{imm}({rs1})']
+    if fmt == 'B':
+        if d.rs2 == 0 and name in ('beq', 'bne', 'blt', 'bge'):
+            return {'beq': 'beqz', 'bne': 'bnez', 'blt': 'bltz', 'bge': 'bgez'}[name], [rs1, _offset(imm)]
+        if d.rs1 == 0 and name in ('blt', 'bge'):
+            return {'blt': 'bgtz', 'bge': 'blez'}[name], [rs2, _offset(imm)]
+        return name, [rs1, rs2, _offset(imm)]
+    if fmt == 'F':
+        pred, succ = imm >> 4, imm & 0xF
+        if pred == succ == 0xF:
+            return name, []
+        return name, [_fence_set(pred), _fence_set(succ)]
+    return name, []
+
+
+@lru_cache(maxsize=4096)
+def disassemble(inst: int) -> str:
+    """Spike-style disassembly: ABI register names, branch targets relative to pc"""
+    decoded = decode(inst)
+    if decoded is None:
+        return 'unknown'
+    name, operands = _operands(decoded)
+    if not operands:
+        return name
+    return name.ljust(7) + ' ' + ', '.join(operands)
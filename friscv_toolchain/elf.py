@@ -0,0 +1,123 @@
+import bisect
+import struct
+
+
+EM_RISCV   = 0xF3
+PT_LOAD    = 1
+SHT_SYMTAB = 2
+SHF_EXECINSTR = 0x4
+STT_OBJECT = 1
+STT_FUNC   = 2
+STT_NOTYPE = 0
+
+
+class ElfImage:
+    """
+    Loadable segments and symbols of a 32-bit little-endian RISC-V ELF.
+    """
+    def __init__(self, path: str, entry: int, segments: list[tuple[int, bytes, int]],
+                 symbols: dict[str, tuple[int, int]]) -> None:
+        self.path = path
+        self.entry = entry
+        self.segments = segments
+        self.symbols = symbols
+        self._sorted = sorted((addr, name) for name, (addr, _) in symbols.items())
+        self._addrs = [addr for addr, _ in self._sorted]
+
+
+    def symbol_at(self, addr: int) -> str | None:
+        """Return the name of the closest symbol at or below addr"""
+        i = bisect.bisect_right(self._addrs, addr) - 1
+        if i < 0:
+            return None
+        return self._sorted[i][1]
+
+
+def read_elf(path: str) -> ElfImage:
+    """
+    Read the loadable contents and symbol table of an RV32 ELF file.
+
+    Args:
+        path: Path to the ELF file
+
+    Returns:
+        ElfImage with segments placed at their physical (load) addresses
+    """
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if data[:4] != b'\x7fELF' or data[4] != 1 or data[5] != 1:
+        raise ValueError(f'{path} is not a 32-bit little-endian ELF file')
+
+    (e_type, e_machine, _, e_entry, e_phoff, e_shoff, _, _,
+     e_phentsize, e_phnum, e_shentsize, e_shnum, _) = struct.unpack_from('<HHIIIIIHHHHHH', data, 16)
+    if e_machine != EM_RISCV:
+        raise ValueError(f'{path} is not a RISC-V ELF file (machine {e_machine:#x})')
+
+    segments = []
+    for i in range(e_phnum):
+        p_type, p_offset, _, p_paddr, p_filesz, p_memsz, _, _ = \
+            struct.unpack_from('<IIIIIIII', data, e_phoff + i * e_phentsize)
+        if p_type == PT_LOAD and p_memsz:
+            segments.append((p_paddr, data[p_offset:p_offset + p_filesz], p_memsz))
+
+    symbols = {}
+    sections = [struct.unpack_from('<IIIIIIIIII', data, e_shoff + i * e_shentsize) for i in range(e_shnum)]
+    for sh in sections:
+        if sh[1] != SHT_SYMTAB:
+            continue
+        strtab = sections[sh[6]]
+        str_off = strtab[4]
+        for off in range(sh[4], sh[4] + sh[5], 16):
+            st_name, st_value, st_size, st_info, _, st_shndx = struct.unpack_from('<IIIBBH', data, off)
+            if not st_name or not st_shndx or (st_info & 0xF) not in (STT_NOTYPE, STT_OBJECT, STT_FUNC):
+                continue
+            end = data.index(b'\0', str_off + st_name)
+            name = data[str_off + st_name:end].decode(errors='replace')
+            if name.startswith('.L') or name.startswith('$'):
+                continue
+            symbols[name] = (st_value, st_size)
+
+    return ElfImage(path, e_entry, segments, symbols)
+
+
+def read_code_sections(path: str) -> tuple[dict[str, int], dict[str, str]]:
+    """
+    Read the executable input sections of a relocatable object (.o).
+
+    Args:
+        path: Path to an object compiled for RV32, e.g. with -ffunction-sections
+
+    Returns:
+        (size of every executable section by name, section name of every symbol defined in one)
+    """
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if data[:4] != b'\x7fELF' or data[4] != 1 or data[5] != 1:
+        raise ValueError(f'{path} is not a 32-bit little-endian ELF file')
+    e_shoff, = struct.unpack_from('<I', data, 32)
+    e_shentsize, e_shnum, e_shstrndx = struct.unpack_from('<HHH', data, 46)
+
+    headers = [struct.unpack_from('<IIIIIIIIII', data, e_shoff + i * e_shentsize) for i in range(e_shnum)]
+
+    def string(table: int, offset: int) -> str:
+        start = headers[table][4] + offset
+        return data[start:data.index(b'\0', start)].decode(errors='replace')
+
+    names = [string(e_shstrndx, sh[0]) for sh in headers]
+    sizes = {names[i]: sh[5] for i, sh in enumerate(headers) if sh[2] & SHF_EXECINSTR}
+
+    symbol_sections = {}
+    for sh in headers:
+        if sh[1] != SHT_SYMTAB:
+            continue
+        for off in range(sh[4], sh[4] + sh[5], 16):
+            st_name, _, _, st_info, _, st_shndx = struct.unpack_from('<IIIBBH', data, off)
+            if not st_name or not 0 < st_shndx < e_shnum or (st_info & 0xF) not in (STT_NOTYPE, STT_FUNC):
+                continue
+            name = string(sh[6], st_name)
+            if names[st_shndx] in sizes and not name.startswith('.L') and not name.startswith('$'):
+                symbol_sections[name] = names[st_shndx]
+
+    return sizes, symbol_sections
@@ -0,0 +1,182 @@
+import argparse
+import os
+import signal
+import sys
+import time
+
+from .bench import group_commits, synthetic_log
+
+
+PROMPT = '(spike) '
+
+
+def _env(name: str, default: str = '') -> str:
+    return os.environ.get(f'FAKE_SPIKE_{name}', default)
+
+
+def _parse_positions(text: str) -> dict[int, float]:
+    """Parse 'N[:SECONDS],...' into {commit index: seconds}"""
+    positions = {}
+    for item in filter(None, text.split(',')):
+        index, _, seconds = item.partition(':')
+        positions[int(index)] = float(seconds or 0)
+    return positions
+
+
+class FakeSpike:
+    """
+    Stand-in for spike -d --log-commits that answers debug commands from a
+    recorded or synthetic commit log, with optional stalls, split lines and crashes.
+    """
+    def __init__(
+        self,
+        commits: list[list[str]],
+        log_commits: bool = True,
+        rate: float = 0,
+        stalls: dict[int, float] | None = None,
+        partial: dict[int, float] | None = None,
+        crash_at: int | None = None,
+        at_end: str = 'loop',
+        prompt: bool = True,
+        out=sys.stdout
+    ) -> None:
+        self.commits = commits
+        self.log_commits = log_commits
+        self.rate = rate
+        self.stalls = stalls or {}
+        self.partial = partial or {}
+        self.crash_at = crash_at
+        self.at_end = at_end
+        self.prompt = prompt
+        self.out = out
+        self.emitted = 0
+        self._started = time.perf_counter()
+
+
+    def _write_commit(self, lines: list[str]) -> None:
+        index = self.emitted
+        if index in self.stalls:
+            time.sleep(self.stalls[index])
+        if self.rate:
+            delay = self._started + index / self.rate - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+
+        text = '\n'.join(lines if self.log_commits else lines[:1]) + '\n'
+        if index == self.crash_at:
+            # Die in the middle of a line, like a simulator killed mid-write
+            self.out.write(text[:len(text) // 2])
+            self.out.flush()
+            os.kill(os.getpid(), signal.SIGSEGV)
+        if index in self.partial:
+            self.out.write(text[:len(text) // 2])
+            self.out.flush()
+            time.sleep(self.partial[index])
+            text = text[len(text) // 2:]
+        self.out.write(text)
+        self.out.flush()
+        self.emitted += 1
+
+
+    def step(self, count: int | None) -> bool:
+        """
+        Emit count commits (all remaining ones if None).
+
+        Returns:
+            False when the simulator should exit
+        """
+        emitted = 0
+        while count is None or emitted < count:
+            if self.emitted < len(self.commits):
+                self._write_commit(self.commits[self.emitted])
+            elif self.at_end == 'exit':
+                return False
+            elif self.at_end == 'hang' or not self.commits:
+                return True
+            else:
+                # Programs end in 'j .', so keep committing the last instruction
+                self._write_commit(self.commits[-1])
+            emitted += 1
+        return True
+
+
+    def serve(self, commands) -> int:
+        """Answer debug commands until quit or end of input; returns the exit code"""
+        previous = 'run 1'
+        while True:
+            if self.prompt:
+                sys.stderr.write(PROMPT)
+                sys.stderr.flush()
+            line = commands.readline()
+            if not line:
+                return 0
+            words = line.split() or previous.split()
+            previous = ' '.join(words)
+
+            if words[0] in ('q', 'quit'):
+                return 0
+            if words[0] in ('r', 'run'):
+                try:
+                    count = int(words[1]) if len(words) > 1 else None
+                except ValueError:
+                    sys.stderr.write(f'Invalid count: {words[1]}\n')
+                    continue
+                if not self.step(count):
+                    return 0
+            else:
+                sys.stderr.write(f'Unknown command {words[0]}\n')
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description='Fake Spike for offline and load testing. Options not listed here (--isa, -m, --pc) are '
+                    'accepted and ignored; every --fake-* option defaults to the matching FAKE_SPIKE_* '
+                    'environment variable so it can be set when SpikeInterface builds the command line.'
+    )
+    parser.add_argument('-d', dest='debug', action='store_true', help='Interactive debug mode')
+    parser.add_argument('--log-commits', action='store_true', help='Print register and store lines')
+    parser.add_argument('elf', nargs='?', help='Program (ignored)')
+    parser.add_argument('--fake-replay', default=_env('REPLAY'), metavar='LOG',
+                        help='Replay this recorded commit log (FAKE_SPIKE_REPLAY)')
+    parser.add_argument('--fake-commits', type=int, default=int(_env('COMMITS', '10000')),
+                        help='Length of the synthetic log (FAKE_SPIKE_COMMITS)')
+    parser.add_argument('--fake-reg-density', type=float, default=float(_env('REG_DENSITY', '0.7')))
+    parser.add_argument('--fake-store-density', type=float, default=float(_env('STORE_DENSITY', '0.1')))
+    parser.add_argument('--fake-seed', type=int, default=int(_env('SEED', '0')))
+    parser.add_argument('--fake-rate', type=float, default=float(_env('RATE', '0')),
+                        help='Commits per second, 0 for unlimited (FAKE_SPIKE_RATE)')
+    parser.add_argument('--fake-stall', default=_env('STALL'), metavar='N:SECONDS,...',
+                        help='Stall before these commits (FAKE_SPIKE_STALL)')
+    parser.add_argument('--fake-partial', default=_env('PARTIAL'), metavar='N:SECONDS,...',
+                        help='Write these commits in two halves with a pause between (FAKE_SPIKE_PARTIAL)')
+    parser.add_argument('--fake-crash', type=int, default=int(_env('CRASH')) if _env('CRASH') else None,
+                        metavar='N', help='Die with SIGSEGV halfway through commit N (FAKE_SPIKE_CRASH)')
+    parser.add_argument('--fake-at-end', choices=['loop', 'exit', 'hang'], default=_env('AT_END', 'loop'),
+                        help='After the log: repeat the last commit, exit, or stop answering (FAKE_SPIKE_AT_END)')
+    args, _ = parser.parse_known_args()
+
+    if args.fake_replay:
+        with open(args.fake_replay, 'r') as f:
+            lines = [line.rstrip('\n') for line in f if line.strip()]
+        commits = group_commits([line for line in lines if not line.startswith(PROMPT.strip())])
+    else:
+        commits = group_commits(synthetic_log(args.fake_commits, args.fake_reg_density,
+                                              args.fake_store_density, args.fake_seed))
+
+    spike = FakeSpike(
+        commits,
+        log_commits=args.log_commits,
+        rate=args.fake_rate,
+        stalls=_parse_positions(args.fake_stall),
+        partial=_parse_positions(args.fake_partial),
+        crash_at=args.fake_crash,
+        at_end=args.fake_at_end,
+        prompt=args.debug
+    )
+    if args.debug:
+        sys.exit(spike.serve(sys.stdin))
+    spike.step(None if args.fake_at_end != 'loop' else len(commits))
+
+
+if __name__ == '__main__':
+    main()
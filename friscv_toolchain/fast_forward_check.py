@@ -0,0 +1,266 @@
+import argparse
+import random
+import sys
+
+from .decoder import decode, disassemble, encode
+from .elf import ElfImage
+from .fast_forward import FastForward, Memory, MASK32, MAX_SKIP_INSTS
+from .isa_tables import ACCESSES, GENERATOR_OPCODES
+
+
+CODE_BASE = 0x80000000
+DATA_BASE = 0x80008000
+UNMAPPED = 0x10000000
+
+# Registers the random programs compute with; s0 holds DATA_BASE, s1 UNMAPPED and s2 the loop count
+POOL = (5, 6, 7, 10, 11, 12, 13, 14, 15)
+_ALU_OPCODES = [(name, fmt) for name, fmt in GENERATOR_OPCODES if fmt in ('R', 'I', 'SH', 'U')]
+_LOAD_OPCODES = [name for name, fmt in GENERATOR_OPCODES if fmt == 'L']
+_STORE_OPCODES = [name for name, fmt in GENERATOR_OPCODES if fmt == 'S']
+_BRANCH_OPCODES = [name for name, fmt in GENERATOR_OPCODES if fmt == 'B']
+
+_IMM_OPS = {'addi': 'add', 'slti': 'slt', 'sltiu': 'sltu', 'xori': 'xor', 'ori': 'or', 'andi': 'and',
+            'slli': 'sll', 'srli': 'srl', 'srai': 'sra'}
+
+
+def _signed(value: int) -> int:
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+_ALU = {
+    'add':  lambda a, b: a + b,
+    'sub':  lambda a, b: a - b,
+    'sll':  lambda a, b: a << (b & 31),
+    'slt':  lambda a, b: int(_signed(a) < _signed(b)),
+    'sltu': lambda a, b: int(a < b),
+    'xor':  lambda a, b: a ^ b,
+    'srl':  lambda a, b: a >> (b & 31),
+    'sra':  lambda a, b: _signed(a) >> (b & 31),
+    'or':   lambda a, b: a | b,
+    'and':  lambda a, b: a & b,
+}
+
+_BRANCHES = {
+    'beq':  lambda a, b: a == b,
+    'bne':  lambda a, b: a != b,
+    'blt':  lambda a, b: _signed(a) < _signed(b),
+    'bge':  lambda a, b: _signed(a) >= _signed(b),
+    'bltu': lambda a, b: a < b,
+    'bgeu': lambda a, b: a >= b,
+}
+
+
+class Interpreter:
+    """
+    One-instruction-at-a-time RV32I reference with the run/halt interface of FastForward.
+    """
+    def __init__(self, image: ElfImage) -> None:
+        self.memory = Memory()
+        self.memory.load_image(image)
+        self.regs = [0] * 32
+        self.pc = image.entry
+        self.instret = 0
+        self.halted = False
+        self.halt_reason: str | None = None
+
+
+    def run(self, max_insts: int | None = None, until_pc: int | None = None) -> int:
+        executed = 0
+        while max_insts is None or executed < max_insts:
+            if executed and self.pc == until_pc:
+                break
+            if not self.step():
+                break
+            executed += 1
+        self.instret += executed
+        return executed
+
+
+    def _halt(self, reason: str) -> bool:
+        self.halted = True
+        self.halt_reason = reason
+        return False
+
+
+    def step(self) -> bool:
+        """Execute one instruction; False if it halts the program instead"""
+        x, pc = self.regs, self.pc
+        try:
+            inst = self.memory.load(pc, 4)
+        except MemoryError:
+            return self._halt('fetch fault')
+        d = decode(inst)
+        if d is None or d.name in ('ecall', 'ebreak'):
+            return self._halt(d.name if d else f'unsupported instruction {inst:#010x} at {pc:#x}')
+
+        name, rd, a, b = d.name, d.rd, x[d.rs1], x[d.rs2]
+        value = None
+        nxt = (pc + 4) & MASK32
+        if name == 'lui':
+            value = d.imm << 12
+        elif name == 'auipc':
+            value = pc + (d.imm << 12)
+        elif name == 'jal':
+            if not d.imm:
+                return self._halt('self-loop')
+            value, nxt = pc + 4, (pc + d.imm) & MASK32
+        elif name == 'jalr':
+            value, nxt = pc + 4, (a + d.imm) & 0xFFFFFFFE
+        elif name in _BRANCHES:
+            if _BRANCHES[name](a, b):
+                nxt = (pc + d.imm) & MASK32
+        elif d.fmt == 'L':
+            size, signed = ACCESSES[name]
+            try:
+                value = self.memory.load((a + d.imm) & MASK32, size)
+            except MemoryError:
+                return self._halt('load fault')
+            if signed and value >> (8 * size - 1):
+                value -= 1 << (8 * size)
+        elif d.fmt == 'S':
+            try:
+                self.memory.store((a + d.imm) & MASK32, ACCESSES[name][0], b)
+            except MemoryError:
+                return self._halt('store fault')
+        elif name in _IMM_OPS:
+            value = _ALU[_IMM_OPS[name]](a, d.imm & MASK32)
+        elif name in _ALU:
+            value = _ALU[name](a, b)
+        elif name != 'fence':
+            return self._halt(f'unsupported instruction {inst:#010x} at {pc:#x}')
+
+        if value is not None and rd:
+            x[rd] = value & MASK32
+        self.pc = nxt
+        return True
+
+
+def _quiet(rng: random.Random) -> int:
+    """An instruction that emits no code in a compiled block"""
+    kind = rng.randrange(3)
+    if kind == 0:
+        return encode('addi')
+    if kind == 1:
+        return encode('fence', imm=0xFF)
+    name, fmt = rng.choice(_ALU_OPCODES)
+    return encode(name, rd=0, rs1=rng.choice(POOL), rs2=rng.choice(POOL), imm=rng.randrange(32))
+
+
+def _straight(rng: random.Random, fault_rate: float) -> int:
+    """A random ALU, load, store or quiet instruction"""
+    kind = rng.random()
+    if kind < 0.15:
+        return _quiet(rng)
+    if kind < 0.6:
+        name, fmt = rng.choice(_ALU_OPCODES)
+        imm = rng.randrange(32) if fmt == 'SH' else rng.randrange(1 << 20) if fmt == 'U' else rng.randrange(-2048, 2048)
+        return encode(name, rd=rng.choice(POOL + (0,)), rs1=rng.choice(POOL + (0,)), rs2=rng.choice(POOL), imm=imm)
+    base = 9 if rng.random() < fault_rate else 8
+    offset = rng.randrange(-64, 2048) if rng.random() < 0.2 else rng.randrange(0, 2048, 4)
+    if kind < 0.8:
+        return encode(rng.choice(_LOAD_OPCODES), rd=rng.choice(POOL + (0,)), rs1=base, imm=offset)
+    return encode(rng.choice(_STORE_OPCODES), rs1=base, rs2=rng.choice(POOL), imm=offset)
+
+
+def random_program(rng: random.Random, length: int = 40, fault_rate: float = 0.01) -> ElfImage:
+    """
+    A loop of random straight-line code and forward branches, some of them
+    over regions that emit nothing, ending in a self-loop. Its data page
+    holds random bytes; a few accesses go to an unmapped address.
+    """
+    words = [encode('lui', rd=8, imm=DATA_BASE >> 12), encode('lui', rd=9, imm=UNMAPPED >> 12),
+             encode('addi', rd=18, imm=rng.randrange(1, 40))]
+    for reg in POOL:
+        words += [encode('lui', rd=reg, imm=rng.randrange(1 << 20)),
+                  encode('addi', rd=reg, rs1=reg, imm=rng.randrange(-2048, 2048))]
+    loop = len(words)
+    while len(words) - loop < length:
+        if rng.random() < 0.25:
+            skipped = rng.randrange(1, MAX_SKIP_INSTS + 4)
+            quiet = rng.random() < 0.3
+            words.append(encode(rng.choice(_BRANCH_OPCODES), rs1=rng.choice(POOL + (0,)),
+                                rs2=rng.choice(POOL + (0,)), imm=4 * (skipped + 1)))
+            words += [_quiet(rng) if quiet else _straight(rng, fault_rate) for _ in range(skipped)]
+        else:
+            words.append(_straight(rng, fault_rate))
+    words += [encode('addi', rd=18, rs1=18, imm=-1),
+              encode('bne', rs1=18, imm=4 * (loop - len(words) - 1)),
+              encode('jal', imm=0)]
+
+    code = b''.join(word.to_bytes(4, 'little') for word in words)
+    data = bytes(rng.randrange(256) for _ in range(4096))
+    return ElfImage('<random>', CODE_BASE, [(CODE_BASE, code, len(code)), (DATA_BASE, data, len(data))], {})
+
+
+def _state(sim) -> tuple:
+    return sim.pc, sim.instret, tuple(sim.regs), sim.halted, sim.halt_reason
+
+
+def check_program(image: ElfImage, rng: random.Random) -> str | None:
+    """
+    Run a program on FastForward and the Interpreter with the same sequence
+    of run() calls: to the end, in chunks of max_insts, or to repeated
+    visits of an until_pc. Returns the first difference, or None.
+    """
+    engine, reference = FastForward(image), Interpreter(image)
+    mode = rng.choice(('whole', 'chunks', 'until'))
+    code_end = CODE_BASE + image.segments[0][2]
+    for call in range(10000):
+        if engine.halted or reference.halted:
+            break
+        kwargs = {}
+        if mode == 'chunks':
+            kwargs['max_insts'] = rng.choice((1, 2, 7, rng.randrange(1, 500)))
+        elif mode == 'until' and call < 20:
+            kwargs['until_pc'] = rng.randrange(CODE_BASE, code_end, 4)
+            kwargs['max_insts'] = 100000
+        try:
+            done = engine.run(**kwargs), reference.run(**kwargs)
+        except SyntaxError as e:
+            return f'run({kwargs}) call {call}: fast-forward compiled an invalid block: {e}'
+        if done[0] != done[1] or _state(engine) != _state(reference):
+            return (f'run({kwargs}) call {call}: fast-forward retired {done[0]} to {_state(engine)[:2]} '
+                    f'({engine.halt_reason}), reference {done[1]} to {_state(reference)[:2]} '
+                    f'({reference.halt_reason})' +
+                    ''.join(f'\n  x{r}: {engine.regs[r]:#010x} != {reference.regs[r]:#010x}'
+                            for r in range(32) if engine.regs[r] != reference.regs[r]))
+    for (base, ours), (_, theirs) in zip(engine.memory.regions, reference.memory.regions):
+        if ours != theirs:
+            addr = base + next(i for i in range(len(ours)) if ours[i] != theirs[i])
+            return f'memory differs first at {addr:#010x}'
+    if engine.memory.dirty != reference.memory.dirty:
+        return f'dirty pages differ: {sorted(engine.memory.dirty ^ reference.memory.dirty)}'
+    return None
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description='Check the fast-forward engine against a step interpreter on random programs'
+    )
+    parser.add_argument('--programs', type=int, default=500, help='Number of random programs')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--fault-rate', type=float, default=0.01,
+                        help='Share of loads and stores that go to an unmapped address')
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    retired = faults = 0
+    for n in range(args.programs):
+        image = random_program(rng, fault_rate=args.fault_rate)
+        error = check_program(image, rng)
+        if error:
+            code = image.segments[0][1]
+            print(f'Program {n} (seed {args.seed}): {error}')
+            for offset in range(0, len(code), 4):
+                inst = int.from_bytes(code[offset:offset + 4], 'little')
+                print(f'  {CODE_BASE + offset:#010x}: {inst:08x}  {disassemble(inst)}')
+            sys.exit(1)
+        reference = Interpreter(image)
+        reference.run()
+        retired += reference.instret
+        faults += reference.halt_reason in ('load fault', 'store fault')
+    print(f'{args.programs} programs matched ({retired} instructions, {faults} stopped on a fault)')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,228 @@
+import argparse
+import sys
+from itertools import combinations
+from pathlib import Path
+
+
+ISA_DIR = Path(__file__).parent / 'isa'
+OUTPUT_PATH = Path(__file__).parent / 'isa_tables.py'
+
+# Bit offset and width of the fixed fields an encoding may list
+FIELDS = {
+    'opcode': (0, 7),
+    'rd':     (7, 5),
+    'funct3': (12, 3),
+    'rs1':    (15, 5),
+    'rs2':    (20, 5),
+    'funct7': (25, 7),
+    'imm12':  (20, 12),
+}
+
+# Memory access sizes a load or store may give with size=N
+ACCESS_SIZES = (1, 2, 4)
+
+# Coverage bins of every instruction of a format, besides 'executed' (see coverage.BIN_TESTS).
+# A new format also needs its operand fields in decoder.py.
+FORMAT_BINS = {
+    'R':  ('rd=zero', 'rd=rs1', 'rs1=rs2'),
+    'I':  ('rd=zero', 'imm<0', 'imm=0', 'imm>0'),
+    'SH': ('shamt=0', 'shamt=31'),
+    'L':  ('offset<0', 'offset=0', 'offset>0', 'rd=rs1'),
+    'S':  ('offset<0', 'offset=0', 'offset>0'),
+    'B':  ('taken', 'not-taken', 'backward', 'rs1=rs2'),
+    'U':  ('rd=zero',),
+    'J':  ('rd=zero', 'rd=ra'),
+    'JR': ('rd=zero', 'rd=ra'),
+    'F':  (),
+    'N':  (),
+}
+
+
+class Instruction:
+    """
+    One line of an ISA table.
+    """
+    def __init__(self, name: str, fmt: str, cls: str, mask: int, match: int, extension: str,
+                 generate: bool, size: int | None = None, signed: bool = False) -> None:
+        self.name = name
+        self.fmt = fmt
+        self.cls = cls
+        self.mask = mask
+        self.match = match
+        self.extension = extension
+        self.generate = generate
+        self.size = size
+        self.signed = signed
+
+
+def parse_table(path: Path) -> list[Instruction]:
+    """
+    Read an ISA table: 'mnemonic format class field=value ... [size=N [unsigned]] [nogen]' per line.
+
+    Raises:
+        ValueError: On a malformed line, with its location
+    """
+    instructions = []
+    for lineno, line in enumerate(path.read_text().splitlines(), 1):
+        words = line.split('#', 1)[0].split()
+        if not words:
+            continue
+        where = f'{path.name}:{lineno}'
+        if len(words) < 4:
+            raise ValueError(f'{where}: expected mnemonic, format, class and fields')
+        name, fmt, cls, *rest = words
+        if fmt not in FORMAT_BINS:
+            raise ValueError(f'{where}: unknown format {fmt} (known: {", ".join(FORMAT_BINS)})')
+
+        mask = match = 0
+        generate = True
+        size = None
+        unsigned = False
+        for item in rest:
+            if item == 'nogen':
+                generate = False
+                continue
+            if item == 'unsigned':
+                unsigned = True
+                continue
+            field, _, value = item.partition('=')
+            if field == 'size':
+                if not value.isdigit() or int(value) not in ACCESS_SIZES:
+                    raise ValueError(f'{where}: bad access size {item}')
+                size = int(value)
+                continue
+            if field not in FIELDS or not value:
+                raise ValueError(f'{where}: bad field {item}')
+            offset, width = FIELDS[field]
+            value = int(value, 0)
+            if value >> width:
+                raise ValueError(f'{where}: {field}={value:#x} does not fit in {width} bits')
+            mask |= ((1 << width) - 1) << offset
+            match |= value << offset
+        if mask & 0x7F != 0x7F:
+            raise ValueError(f'{where}: {name} has no opcode')
+        if (size is not None) != (cls in ('load', 'store')):
+            raise ValueError(f'{where}: size=N is required for loads and stores and only allowed for them')
+        if unsigned and cls != 'load':
+            raise ValueError(f'{where}: only loads can be unsigned')
+        instructions.append(Instruction(name, fmt, cls, mask, match, path.stem, generate,
+                                        size, cls == 'load' and not unsigned))
+    return instructions
+
+
+def load_isa(extensions: list[str] | None = None, isa_dir: Path = ISA_DIR) -> list[Instruction]:
+    """
+    The instructions of every table in isa_dir (or only the named ones).
+
+    Raises:
+        ValueError: If a mnemonic is defined twice or two encodings overlap
+    """
+    paths = sorted(isa_dir.glob('*.opcodes'))
+    if extensions:
+        unknown = set(extensions) - {path.stem for path in paths}
+        if unknown:
+            raise ValueError(f'No ISA table for {", ".join(sorted(unknown))} in {isa_dir}')
+        paths = [path for path in paths if path.stem in extensions]
+
+    instructions = [inst for path in paths for inst in parse_table(path)]
+    names = set()
+    for inst in instructions:
+        if inst.name in names:
+            raise ValueError(f'{inst.name} is defined twice')
+        names.add(inst.name)
+    for a, b in combinations(instructions, 2):
+        if not (a.match ^ b.match) & a.mask & b.mask:
+            raise ValueError(f'The encodings of {a.name} ({a.extension}) and {b.name} ({b.extension}) overlap')
+    return instructions
+
+
+def render(instructions: list[Instruction]) -> str:
+    """Source of the generated isa_tables module"""
+    extensions = list(dict.fromkeys(inst.extension for inst in instructions))
+    by_opcode: dict[int, list[Instruction]] = {}
+    for inst in instructions:
+        by_opcode.setdefault(inst.match & 0x7F, []).append(inst)
+
+    def encoding(inst: Instruction) -> str:
+        return f'({inst.name!r}, {inst.fmt!r}, {inst.mask:#010x}, {inst.match:#010x})'
+
+    lines = [
+        '# Generated by python3 -m friscv_toolchain.isa_gen from friscv_toolchain/isa/*.opcodes.',
+        '# Do not edit: change the tables and regenerate.',
+        '',
+        f'EXTENSIONS = {tuple(extensions)!r}',
+        '',
+        '# (mnemonic, operand format, mask, match) of every instruction',
+        'ENCODINGS = (',
+        *(f'    {encoding(inst)},' for inst in instructions),
+        ')',
+        '',
+        '# Candidate encodings per major opcode, most specific mask first',
+        'DECODE_TABLE = {',
+    ]
+    for opcode in sorted(by_opcode):
+        candidates = sorted(by_opcode[opcode], key=lambda inst: -bin(inst.mask).count('1'))
+        lines.append(f'    {opcode:#04x}: (')
+        lines += [f'        {encoding(inst)},' for inst in candidates]
+        lines.append('    ),')
+    lines += [
+        '}',
+        '',
+        '# Instruction class of every mnemonic',
+        'CLASSES = {',
+        *(f'    {inst.name!r}: {inst.cls!r},' for inst in instructions),
+        '}',
+        '',
+        '# (size in bytes, sign-extended) of every load and store',
+        'ACCESSES = {',
+        *(f'    {inst.name!r}: ({inst.size}, {inst.signed}),' for inst in instructions if inst.size),
+        '}',
+        '',
+        '# Coverage bins of every mnemonic (see coverage.BIN_TESTS)',
+        'COVERAGE_BINS = {',
+        *(f'    {inst.name!r}: {("executed",) + FORMAT_BINS[inst.fmt]!r},' for inst in instructions),
+        '}',
+        '',
+        '# (mnemonic, operand format) the random instruction generator draws from',
+        'GENERATOR_OPCODES = (',
+        *(f'    ({inst.name!r}, {inst.fmt!r}),' for inst in instructions if inst.generate),
+        ')',
+    ]
+    return '\n'.join(lines) + '\n'
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description='Generate the decoder, class, coverage and generator tables from the ISA tables'
+    )
+    parser.add_argument('--ext', action='append', metavar='NAME',
+                        help=f'Only this table of {ISA_DIR} (repeatable; default: all)')
+    parser.add_argument('--output', type=Path, default=OUTPUT_PATH)
+    parser.add_argument('--check', action='store_true', help='Fail if the output is out of date instead of writing it')
+    args = parser.parse_args()
+
+    from .coverage import BIN_TESTS
+    unknown_bins = {b for bins in FORMAT_BINS.values() for b in bins} - set(BIN_TESTS)
+    if unknown_bins:
+        parser.error(f'Coverage bins without a test in coverage.BIN_TESTS: {", ".join(sorted(unknown_bins))}')
+
+    try:
+        instructions = load_isa(args.ext)
+    except ValueError as e:
+        print(f'Error: {e}', file=sys.stderr)
+        raise SystemExit(1)
+    source = render(instructions)
+
+    if args.check:
+        if not args.output.exists() or args.output.read_text() != source:
+            print(f'{args.output} is out of date; run python3 -m friscv_toolchain.isa_gen', file=sys.stderr)
+            raise SystemExit(1)
+        print(f'{args.output} is up to date')
+        return
+    args.output.write_text(source)
+    print(f'Wrote {len(instructions)} instructions of {", ".join(sorted({i.extension for i in instructions}))} '
+          f'to {args.output}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,253 @@
+# Generated by python3 -m friscv_toolchain.isa_gen from friscv_toolchain/isa/*.opcodes.
+# Do not edit: change the tables and regenerate.
+
+EXTENSIONS = ('rv32i',)
+
+# (mnemonic, operand format, mask, match) of every instruction
+ENCODINGS = (
+    ('lui', 'U', 0x0000007f, 0x00000037),
+    ('auipc', 'U', 0x0000007f, 0x00000017),
+    ('jal', 'J', 0x0000007f, 0x0000006f),
+    ('jalr', 'JR', 0x0000707f, 0x00000067),
+    ('beq', 'B', 0x0000707f, 0x00000063),
+    ('bne', 'B', 0x0000707f, 0x00001063),
+    ('blt', 'B', 0x0000707f, 0x00004063),
+    ('bge', 'B', 0x0000707f, 0x00005063),
+    ('bltu', 'B', 0x0000707f, 0x00006063),
+    ('bgeu', 'B', 0x0000707f, 0x00007063),
+    ('lb', 'L', 0x0000707f, 0x00000003),
+    ('lh', 'L', 0x0000707f, 0x00001003),
+    ('lw', 'L', 0x0000707f, 0x00002003),
+    ('lbu', 'L', 0x0000707f, 0x00004003),
+    ('lhu', 'L', 0x0000707f, 0x00005003),
+    ('sb', 'S', 0x0000707f, 0x00000023),
+    ('sh', 'S', 0x0000707f, 0x00001023),
+    ('sw', 'S', 0x0000707f, 0x00002023),
+    ('addi', 'I', 0x0000707f, 0x00000013),
+    ('slti', 'I', 0x0000707f, 0x00002013),
+    ('sltiu', 'I', 0x0000707f, 0x00003013),
+    ('xori', 'I', 0x0000707f, 0x00004013),
+    ('ori', 'I', 0x0000707f, 0x00006013),
+    ('andi', 'I', 0x0000707f, 0x00007013),
+    ('slli', 'SH', 0xfe00707f, 0x00001013),
+    ('srli', 'SH', 0xfe00707f, 0x00005013),
+    ('srai', 'SH', 0xfe00707f, 0x40005013),
+    ('add', 'R', 0xfe00707f, 0x00000033),
+    ('sub', 'R', 0xfe00707f, 0x40000033),
+    ('sll', 'R', 0xfe00707f, 0x00001033),
+    ('slt', 'R', 0xfe00707f, 0x00002033),
+    ('sltu', 'R', 0xfe00707f, 0x00003033),
+    ('xor', 'R', 0xfe00707f, 0x00004033),
+    ('srl', 'R', 0xfe00707f, 0x00005033),
+    ('sra', 'R', 0xfe00707f, 0x40005033),
+    ('or', 'R', 0xfe00707f, 0x00006033),
+    ('and', 'R', 0xfe00707f, 0x00007033),
+    ('fence', 'F', 0x0000707f, 0x0000000f),
+    ('ecall', 'N', 0xffffffff, 0x00000073),
+    ('ebreak', 'N', 0xffffffff, 0x00100073),
+)
+
+# Candidate encodings per major opcode, most specific mask first
+DECODE_TABLE = {
+    0x03: (
+        ('lb', 'L', 0x0000707f, 0x00000003),
+        ('lh', 'L', 0x0000707f, 0x00001003),
+        ('lw', 'L', 0x0000707f, 0x00002003),
+        ('lbu', 'L', 0x0000707f, 0x00004003),
+        ('lhu', 'L', 0x0000707f, 0x00005003),
+    ),
+    0x0f: (
+        ('fence', 'F', 0x0000707f, 0x0000000f),
+    ),
+    0x13: (
+        ('slli', 'SH', 0xfe00707f, 0x00001013),
+        ('srli', 'SH', 0xfe00707f, 0x00005013),
+        ('srai', 'SH', 0xfe00707f, 0x40005013),
+        ('addi', 'I', 0x0000707f, 0x00000013),
+        ('slti', 'I', 0x0000707f, 0x00002013),
+        ('sltiu', 'I', 0x0000707f, 0x00003013),
+        ('xori', 'I', 0x0000707f, 0x00004013),
+        ('ori', 'I', 0x0000707f, 0x00006013),
+        ('andi', 'I', 0x0000707f, 0x00007013),
+    ),
+    0x17: (
+        ('auipc', 'U', 0x0000007f, 0x00000017),
+    ),
+    0x23: (
+        ('sb', 'S', 0x0000707f, 0x00000023),
+        ('sh', 'S', 0x0000707f, 0x00001023),
+        ('sw', 'S', 0x0000707f, 0x00002023),
+    ),
+    0x33: (
+        ('add', 'R', 0xfe00707f, 0x00000033),
+        ('sub', 'R', 0xfe00707f, 0x40000033),
+        ('sll', 'R', 0xfe00707f, 0x00001033),
+        ('slt', 'R', 0xfe00707f, 0x00002033),
+        ('sltu', 'R', 0xfe00707f, 0x00003033),
+        ('xor', 'R', 0xfe00707f, 0x00004033),
+        ('srl', 'R', 0xfe00707f, 0x00005033),
+        ('sra', 'R', 0xfe00707f, 0x40005033),
+        ('or', 'R', 0xfe00707f, 0x00006033),
+        ('and', 'R', 0xfe00707f, 0x00007033),
+    ),
+    0x37: (
+        ('lui', 'U', 0x0000007f, 0x00000037),
+    ),
+    0x63: (
+        ('beq', 'B', 0x0000707f, 0x00000063),
+        ('bne', 'B', 0x0000707f, 0x00001063),
+        ('blt', 'B', 0x0000707f, 0x00004063),
+        ('bge', 'B', 0x0000707f, 0x00005063),
+        ('bltu', 'B', 0x0000707f, 0x00006063),
+        ('bgeu', 'B', 0x0000707f, 0x00007063),
+    ),
+    0x67: (
+        ('jalr', 'JR', 0x0000707f, 0x00000067),
+    ),
+    0x6f: (
+        ('jal', 'J', 0x0000007f, 0x0000006f),
+    ),
+    0x73: (
+        ('ecall', 'N', 0xffffffff, 0x00000073),
+        ('ebreak', 'N', 0xffffffff, 0x00100073),
+    ),
+}
+
+# Instruction class of every mnemonic
+CLASSES = {
+    'lui': 'lui',
+    'auipc': 'auipc',
+    'jal': 'jal',
+    'jalr': 'jalr',
+    'beq': 'branch',
+    'bne': 'branch',
+    'blt': 'branch',
+    'bge': 'branch',
+    'bltu': 'branch',
+    'bgeu': 'branch',
+    'lb': 'load',
+    'lh': 'load',
+    'lw': 'load',
+    'lbu': 'load',
+    'lhu': 'load',
+    'sb': 'store',
+    'sh': 'store',
+    'sw': 'store',
+    'addi': 'op-imm',
+    'slti': 'op-imm',
+    'sltiu': 'op-imm',
+    'xori': 'op-imm',
+    'ori': 'op-imm',
+    'andi': 'op-imm',
+    'slli': 'op-imm',
+    'srli': 'op-imm',
+    'srai': 'op-imm',
+    'add': 'op',
+    'sub': 'op',
+    'sll': 'op',
+    'slt': 'op',
+    'sltu': 'op',
+    'xor': 'op',
+    'srl': 'op',
+    'sra': 'op',
+    'or': 'op',
+    'and': 'op',
+    'fence': 'fence',
+    'ecall': 'system',
+    'ebreak': 'system',
+}
+
+# (size in bytes, sign-extended) of every load and store
+ACCESSES = {
+    'lb': (1, True),
+    'lh': (2, True),
+    'lw': (4, True),
+    'lbu': (1, False),
+    'lhu': (2, False),
+    'sb': (1, False),
+    'sh': (2, False),
+    'sw': (4, False),
+}
+
+# Coverage bins of every mnemonic (see coverage.BIN_TESTS)
+COVERAGE_BINS = {
+    'lui': ('executed', 'rd=zero'),
+    'auipc': ('executed', 'rd=zero'),
+    'jal': ('executed', 'rd=zero', 'rd=ra'),
+    'jalr': ('executed', 'rd=zero', 'rd=ra'),
+    'beq': ('executed', 'taken', 'not-taken', 'backward', 'rs1=rs2'),
+    'bne': ('executed', 'taken', 'not-taken', 'backward', 'rs1=rs2'),
+    'blt': ('executed', 'taken', 'not-taken', 'backward', 'rs1=rs2'),
+    'bge': ('executed', 'taken', 'not-taken', 'backward', 'rs1=rs2'),
+    'bltu': ('executed', 'taken', 'not-taken', 'backward', 'rs1=rs2'),
+    'bgeu': ('executed', 'taken', 'not-taken', 'backward', 'rs1=rs2'),
+    'lb': ('executed', 'offset<0', 'offset=0', 'offset>0', 'rd=rs1'),
+    'lh': ('executed', 'offset<0', 'offset=0', 'offset>0', 'rd=rs1'),
+    'lw': ('executed', 'offset<0', 'offset=0', 'offset>0', 'rd=rs1'),
+    'lbu': ('executed', 'offset<0', 'offset=0', 'offset>0', 'rd=rs1'),
+    'lhu': ('executed', 'offset<0', 'offset=0', 'offset>0', 'rd=rs1'),
+    'sb': ('executed', 'offset<0', 'offset=0', 'offset>0'),
+    'sh': ('executed', 'offset<0', 'offset=0', 'offset>0'),
+    'sw': ('executed', 'offset<0', 'offset=0', 'offset>0'),
+    'addi': ('executed', 'rd=zero', 'imm<0', 'imm=0', 'imm>0'),
+    'slti': ('executed', 'rd=zero', 'imm<0', 'imm=0', 'imm>0'),
+    'sltiu': ('executed', 'rd=zero', 'imm<0', 'imm=0', 'imm>0'),
+    'xori': ('executed', 'rd=zero', 'imm<0', 'imm=0', 'imm>0'),
+    'ori': ('executed', 'rd=zero', 'imm<0', 'imm=0', 'imm>0'),
+    'andi': ('executed', 'rd=zero', 'imm<0', 'imm=0', 'imm>0'),
+    'slli': ('executed', 'shamt=0', 'shamt=31'),
+    'srli': ('executed', 'shamt=0', 'shamt=31'),
+    'srai': ('executed', 'shamt=0', 'shamt=31'),
+    'add': ('executed', 'rd=zero', 'rd=rs1', 'rs1=rs2'),
+    'sub': ('executed', 'rd=zero', 'rd=rs1', 'rs1=rs2'),
+    'sll': ('executed', 'rd=zero', 'rd=rs1', 'rs1=rs2'),
+    'slt': ('executed', 'rd=zero', 'rd=rs1', 'rs1=rs2'),
+    'sltu': ('executed', 'rd=zero', 'rd=rs1', 'rs1=rs2'),
+    'xor': ('executed', 'rd=zero', 'rd=rs1', 'rs1=rs2'),
+    'srl': ('executed', 'rd=zero', 'rd=rs1', 'rs1=rs2'),
+    'sra': ('executed', 'rd=zero', 'rd=rs1', 'rs1=rs2'),
+    'or': ('executed', 'rd=zero', 'rd=rs1', 'rs1=rs2'),
+    'and': ('executed', 'rd=zero', 'rd=rs1', 'rs1=rs2'),
+    'fence': ('executed',),
+    'ecall': ('executed',),
+    'ebreak': ('executed',),
+}
+
+# (mnemonic, operand format) the random instruction generator draws from
+GENERATOR_OPCODES = (
+    ('lui', 'U'),
+    ('auipc', 'U'),
+    ('beq', 'B'),
+    ('bne', 'B'),
+    ('blt', 'B'),
+    ('bge', 'B'),
+    ('bltu', 'B'),
+    ('bgeu', 'B'),
+    ('lb', 'L'),
+    ('lh', 'L'),
+    ('lw', 'L'),
+    ('lbu', 'L'),
+    ('lhu', 'L'),
+    ('sb', 'S'),
+    ('sh', 'S'),
+    ('sw', 'S'),
+    ('addi', 'I'),
+    ('slti', 'I'),
+    ('sltiu', 'I'),
+    ('xori', 'I'),
+    ('ori', 'I'),
+    ('andi', 'I'),
+    ('slli', 'SH'),
+    ('srli', 'SH'),
+    ('srai', 'SH'),
+    ('add', 'R'),
+    ('sub', 'R'),
+    ('sll', 'R'),
+    ('slt', 'R'),
+    ('sltu', 'R'),
+    ('xor', 'R'),
+    ('srl', 'R'),
+    ('sra', 'R'),
+    ('or', 'R'),
+    ('and', 'R'),
+)
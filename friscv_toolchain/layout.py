@@ -0,0 +1,272 @@
+import argparse
+import json
+from array import array
+from collections import OrderedDict
+from pathlib import Path
+
+from .compiler import compile_riscv_tests
+from .elf import read_code_sections
+from .fast_forward import FastForward
+from .manifest import discover_tests, select_tests
+from .runner import TEST_RESULT_ADDR, TEST_PASSED
+
+
+BUILD_SCRIPTS_DIR = Path(__file__).parent.parent / 'build_scripts'
+BUILD_SCRIPT_PATH = BUILD_SCRIPTS_DIR / 'build-tests.sh'
+BASE_LINKER_SCRIPT = BUILD_SCRIPTS_DIR / 'linker.ld'
+LAYOUT_CFLAGS = ['-ffunction-sections']
+# Ordered sections go right after this line of linker.ld; the entry code must stay first
+TEXT_ANCHOR = '*(.text.init)'
+
+DEFAULT_LINE_SIZE = 32
+DEFAULT_ICACHE_LINES = 16
+DEFAULT_MAX_INSTS = 2_000_000
+
+OPCODE_JAL = 0x6F
+OPCODE_JALR = 0x67
+REG_RA = 1
+
+
+class Profile:
+    """
+    Every fetch address of one run and the calls between addresses, taken by
+    single-stepping the fast-forward engine (the same functional model Spike
+    is checked against).
+    """
+    def __init__(self, elf_path: Path | str, max_insts: int = DEFAULT_MAX_INSTS) -> None:
+        engine = FastForward(str(elf_path))
+        self.image = engine.image
+        self.pcs = array('I')
+        self.calls: dict[tuple[int, int], int] = {}
+
+        while len(self.pcs) < max_insts:
+            pc = engine.pc
+            inst = engine.memory.load(pc, 4)
+            if not engine.run(max_insts=1):
+                break
+            self.pcs.append(pc)
+            if inst & 0x7F in (OPCODE_JAL, OPCODE_JALR) and (inst >> 7) & 0x1F == REG_RA:
+                key = (pc, engine.pc)
+                self.calls[key] = self.calls.get(key, 0) + 1
+
+        if not engine.halted:
+            self.status = 'timeout'
+        else:
+            self.status = 'pass' if engine.memory.load(TEST_RESULT_ADDR, 4) == TEST_PASSED else 'fail'
+
+
+    def by_section(self, symbol_sections: dict[str, str]) -> tuple[dict[str, int], dict[tuple[str, str], int]]:
+        """
+        Attribute the profile to input sections.
+
+        Returns:
+            (instructions executed per section, calls per (caller section, callee section))
+        """
+        section_at: dict[int, str | None] = {}
+
+        def section(pc: int) -> str | None:
+            if pc not in section_at:
+                section_at[pc] = symbol_sections.get(self.image.symbol_at(pc))
+            return section_at[pc]
+
+        counts: dict[str, int] = {}
+        for pc in self.pcs:
+            name = section(pc)
+            if name is not None:
+                counts[name] = counts.get(name, 0) + 1
+
+        calls: dict[tuple[str, str], int] = {}
+        for (site, target), count in self.calls.items():
+            caller, callee = section(site), section(target)
+            if caller is not None and callee is not None and caller != callee:
+                calls[(caller, callee)] = calls.get((caller, callee), 0) + count
+        return counts, calls
+
+
+def order_sections(counts: dict[str, int], calls: dict[tuple[str, str], int], sizes: dict[str, int]) -> list[str]:
+    """
+    Pettis-Hansen style ordering: join the chains of caller and callee along
+    the heaviest call edges first, then place the chains by execution density
+    (instructions executed per byte), hottest first. Sections that never ran
+    are left to the linker.
+    """
+    movable = {name for name, count in counts.items()
+               if count and name.startswith('.text.') and name != '.text.init' and name in sizes}
+    chain_of = {name: [name] for name in movable}
+    for (caller, callee), _ in sorted(calls.items(), key=lambda edge: (-edge[1], edge[0])):
+        if caller not in chain_of or callee not in chain_of:
+            continue
+        first, second = chain_of[caller], chain_of[callee]
+        if first is second:
+            continue
+        first.extend(second)
+        for name in second:
+            chain_of[name] = first
+
+    chains = list({id(chain): chain for chain in chain_of.values()}.values())
+    chains.sort(key=lambda chain: (-sum(counts[n] for n in chain) / max(1, sum(sizes[n] for n in chain)), chain[0]))
+    return [name for chain in chains for name in chain]
+
+
+def layout_script(order: list[str], base: Path = BASE_LINKER_SCRIPT) -> str:
+    """linker.ld with the given .text.* input sections placed right after the entry code"""
+    lines = base.read_text().splitlines(keepends=True)
+    for i, line in enumerate(lines):
+        if line.strip() == TEXT_ANCHOR:
+            indent = line[:len(line) - len(line.lstrip())]
+            placed = [f'{indent}/* Profile-guided order, hottest first */\n'] + [f'{indent}*({name})\n' for name in order]
+            return ''.join(lines[:i + 1] + placed + lines[i + 1:])
+    raise ValueError(f'{base} has no {TEXT_ANCHOR} line to anchor the layout')
+
+
+def fetch_locality(pcs: array, line_size: int = DEFAULT_LINE_SIZE,
+                   icache_lines: int = DEFAULT_ICACHE_LINES) -> dict[str, int]:
+    """
+    Instruction-fetch locality of a PC sequence.
+
+    Returns:
+        distinct_lines: cache lines touched at all
+        hot_lines: lines covering 99% of fetches
+        line_switches: fetches on a different line than the previous fetch
+        misses: misses of a fully associative LRU cache of icache_lines lines
+    """
+    shift = line_size.bit_length() - 1
+    per_line: dict[int, int] = {}
+    cache: OrderedDict[int, None] = OrderedDict()
+    switches = misses = 0
+    previous = None
+    for pc in pcs:
+        line = pc >> shift
+        per_line[line] = per_line.get(line, 0) + 1
+        if line == previous:
+            continue
+        switches += 1
+        previous = line
+        if line in cache:
+            cache.move_to_end(line)
+        else:
+            misses += 1
+            cache[line] = None
+            if len(cache) > icache_lines:
+                cache.popitem(last=False)
+
+    covered, hot_lines = 0, 0
+    for count in sorted(per_line.values(), reverse=True):
+        if covered >= 0.99 * len(pcs):
+            break
+        covered += count
+        hot_lines += 1
+    return {'distinct_lines': len(per_line), 'hot_lines': hot_lines, 'line_switches': switches, 'misses': misses}
+
+
+def object_sections(bin_dir: Path, test_name: str) -> tuple[dict[str, int], dict[str, str]]:
+    """Executable sections and symbol placement of every object linked into a test"""
+    sizes: dict[str, int] = {}
+    symbol_sections: dict[str, str] = {}
+    for name in ('startup.o', 'runtime.o', f'{test_name}.o'):
+        path = bin_dir / name
+        if path.is_file():
+            object_sizes, object_symbols = read_code_sections(str(path))
+            sizes.update(object_sizes)
+            symbol_sections.update(object_symbols)
+    return sizes, symbol_sections
+
+
+def optimize_layout(test_dir: Path, output_dir: Path, select: str | None = None,
+                    riscv_tools_path: str | None = None, line_size: int = DEFAULT_LINE_SIZE,
+                    icache_lines: int = DEFAULT_ICACHE_LINES, max_insts: int = DEFAULT_MAX_INSTS) -> list[dict] | None:
+    """
+    Build with -ffunction-sections, profile, write a linker script per test,
+    rebuild with it and measure fetch locality before and after.
+
+    Returns:
+        One row per test, or None if a build failed
+    """
+    tests, _ = select_tests(discover_tests(test_dir), select)
+    sources = [test.source for test in tests]
+    base_dir, ordered_dir, scripts_dir = output_dir / 'base', output_dir / 'ordered', output_dir / 'scripts'
+
+    if not compile_riscv_tests(BUILD_SCRIPT_PATH, test_dir, base_dir, riscv_tools_path,
+                               tests=sources, cflags=LAYOUT_CFLAGS):
+        print('The profiling build failed')
+        return None
+
+    scripts_dir.mkdir(parents=True, exist_ok=True)
+    before = {}
+    for test in tests:
+        profile = Profile(test.elf_path(base_dir), max_insts)
+        sizes, symbol_sections = object_sections(base_dir / 'bin', test.name)
+        counts, calls = profile.by_section(symbol_sections)
+        order = order_sections(counts, calls, sizes)
+        (scripts_dir / f'{test.name}.ld').write_text(layout_script(order))
+        before[test.name] = (profile, order)
+
+    if not compile_riscv_tests(BUILD_SCRIPT_PATH, test_dir, ordered_dir, riscv_tools_path,
+                               tests=sources, cflags=LAYOUT_CFLAGS, layout_dir=scripts_dir):
+        print('The ordered build failed')
+        return None
+
+    rows = []
+    for test in tests:
+        profile, order = before[test.name]
+        after = Profile(test.elf_path(ordered_dir), max_insts)
+        rows.append({
+            'test': test.name,
+            'instret': len(profile.pcs),
+            'ordered_sections': len(order),
+            'status_before': profile.status,
+            'status_after': after.status,
+            'same_instret': len(after.pcs) == len(profile.pcs),
+            'before': fetch_locality(profile.pcs, line_size, icache_lines),
+            'after': fetch_locality(after.pcs, line_size, icache_lines),
+        })
+    return rows
+
+
+def format_report(rows: list[dict], line_size: int, icache_lines: int) -> str:
+    lines = [f'Fetch locality with {line_size}-byte lines; misses of a {icache_lines}-line LRU cache',
+             f'{"test":24} {"instret":>9} {"sections":>8}  {"lines":^12}  {"hot lines":^12}  '
+             f'{"switches":^16}  {"misses":^14}']
+    for row in rows:
+        b, a = row['before'], row['after']
+        cells = '  '.join(f'{b[key]:>{w}} -> {a[key]:<{w}}' for key, w in
+                          (('distinct_lines', 4), ('hot_lines', 4), ('line_switches', 6), ('misses', 5)))
+        note = ''
+        if row['status_before'] != row['status_after'] or not row['same_instret']:
+            note = f'  [behaviour changed: {row["status_before"]} -> {row["status_after"]}]'
+        lines.append(f'{row["test"]:24} {row["instret"]:>9} {row["ordered_sections"]:>8}  {cells}{note}')
+    return '\n'.join(lines)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description='Profile-guided .text ordering: build, profile, generate linker scripts, rebuild and compare'
+    )
+    parser.add_argument('--test-dir', type=Path, default=Path('./test_sources/c'))
+    parser.add_argument('--output', type=Path, default=Path('./output/layout'),
+                        help='Directory for the builds and the generated linker scripts')
+    parser.add_argument('--select', metavar='EXPR', help='Manifest selection expression')
+    parser.add_argument('--riscv-tools-path', help='Custom path to RISC-V toolchain')
+    parser.add_argument('--line-size', type=int, default=DEFAULT_LINE_SIZE, help='Cache line size in bytes')
+    parser.add_argument('--icache-lines', type=int, default=DEFAULT_ICACHE_LINES,
+                        help='Lines of the modelled instruction cache')
+    parser.add_argument('--max-insts', type=int, default=DEFAULT_MAX_INSTS, help='Instruction budget per test')
+    parser.add_argument('--json', type=Path, help='Also write the rows as JSON')
+    args = parser.parse_args()
+
+    if args.line_size & (args.line_size - 1):
+        parser.error('--line-size must be a power of two')
+
+    rows = optimize_layout(args.test_dir.resolve(), args.output.resolve(), args.select, args.riscv_tools_path,
+                           args.line_size, args.icache_lines, args.max_insts)
+    if rows is None:
+        raise SystemExit(1)
+    print(format_report(rows, args.line_size, args.icache_lines))
+    print(f'Linker scripts: {args.output / "scripts"}')
+    if args.json:
+        args.json.parent.mkdir(parents=True, exist_ok=True)
+        args.json.write_text(json.dumps(rows, indent=2))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,167 @@
+import asyncio
+import queue
+import threading
+import time
+from collections import deque
+
+
+# Bytes of unread output kept per pipe before its reader stops reading
+DEFAULT_BUFFER_BYTES = 256 * 1024
+
+
+class _Accounting:
+    """Byte use and blocked time shared by the threaded and the asyncio buffer"""
+    def __init__(self, budget: int) -> None:
+        self.budget = budget
+        self.used: dict[str, int] = {}
+        self.peak: dict[str, int] = {}
+        self.lines: dict[str, int] = {}
+        self.producer_blocked: dict[str, float] = {}
+        self.consumer_blocked = 0.0
+
+
+    def full(self, source: str, size: int) -> bool:
+        # A line larger than the whole budget still passes once the buffer is empty
+        used = self.used.get(source, 0)
+        return used > 0 and used + size > self.budget
+
+
+    def added(self, source: str, size: int) -> None:
+        self.used[source] = self.used.get(source, 0) + size
+        self.peak[source] = max(self.peak.get(source, 0), self.used[source])
+        self.lines[source] = self.lines.get(source, 0) + 1
+
+
+    def removed(self, source: str, size: int) -> None:
+        self.used[source] -= size
+
+
+    def stats(self) -> dict:
+        """
+        Buffer use per source and the seconds each side spent waiting: readers
+        waiting for room (the consumer is the bottleneck) and the consumer
+        waiting for lines (the simulator is).
+        """
+        sources = sorted(set(self.lines) | set(self.producer_blocked))
+        return {
+            'budget': self.budget,
+            'sources': {source: {'lines': self.lines.get(source, 0),
+                                 'peak_bytes': self.peak.get(source, 0),
+                                 'blocked': self.producer_blocked.get(source, 0.0)}
+                        for source in sources},
+            'consumer_blocked': self.consumer_blocked
+        }
+
+
+def format_stats(stats: dict) -> str:
+    parts = [f'{source}: {s["lines"]} lines, peak {s["peak_bytes"]}/{stats["budget"]} B, '
+             f'reader blocked {s["blocked"]:.3f}s' for source, s in stats['sources'].items()]
+    parts.append(f'consumer blocked {stats["consumer_blocked"]:.3f}s')
+    return '; '.join(parts)
+
+
+class LineBuffer:
+    """
+    FIFO of (source, line) items between a simulator's pipe reader threads
+    and the thread parsing its output, with a byte budget per source.
+
+    A reader whose source is over budget waits in put() instead of reading
+    on, so the OS pipe fills and the simulator blocks on its own write:
+    memory stays bounded however far the consumer falls behind. get() keeps
+    queue.Queue's contract and raises queue.Empty on timeout.
+    """
+    def __init__(self, budget: int = DEFAULT_BUFFER_BYTES) -> None:
+        self.accounting = _Accounting(budget)
+        self._items: deque[tuple[str, str, int]] = deque()
+        self._closed = False
+        self._cond = threading.Condition()
+
+
+    def put(self, item: tuple[str, str]) -> bool:
+        """Append a line, waiting while its source is over budget; False once the buffer is closed"""
+        source, line = item
+        size = len(line) + 1
+        with self._cond:
+            if self.accounting.full(source, size) and not self._closed:
+                started = time.perf_counter()
+                while self.accounting.full(source, size) and not self._closed:
+                    self._cond.wait()
+                blocked = self.accounting.producer_blocked
+                blocked[source] = blocked.get(source, 0.0) + time.perf_counter() - started
+            if self._closed:
+                return False
+            self._items.append((source, line, size))
+            self.accounting.added(source, size)
+            self._cond.notify_all()
+            return True
+
+
+    def get(self, timeout: float | None = None) -> tuple[str, str]:
+        with self._cond:
+            if not self._items:
+                started = time.perf_counter()
+                self._cond.wait_for(lambda: self._items, timeout)
+                self.accounting.consumer_blocked += time.perf_counter() - started
+                if not self._items:
+                    raise queue.Empty
+            source, line, size = self._items.popleft()
+            self.accounting.removed(source, size)
+            self._cond.notify_all()
+            return source, line
+
+
+    def close(self) -> None:
+        """Drop further lines and release readers waiting for room"""
+        with self._cond:
+            self._closed = True
+            self._cond.notify_all()
+
+
+    def stats(self) -> dict:
+        with self._cond:
+            return self.accounting.stats()
+
+
+class AsyncLineBuffer:
+    """
+    LineBuffer for asyncio stream readers. A line of None marks the end of
+    its source and is never held back.
+    """
+    def __init__(self, budget: int = DEFAULT_BUFFER_BYTES) -> None:
+        self.accounting = _Accounting(budget)
+        self._items: deque[tuple[str, str | None, int]] = deque()
+        self._cond = asyncio.Condition()
+
+
+    async def put(self, item: tuple[str, str | None]) -> None:
+        source, line = item
+        size = len(line) + 1 if line is not None else 0
+        async with self._cond:
+            if self.accounting.full(source, size):
+                started = time.perf_counter()
+                await self._cond.wait_for(lambda: not self.accounting.full(source, size))
+                blocked = self.accounting.producer_blocked
+                blocked[source] = blocked.get(source, 0.0) + time.perf_counter() - started
+            self._items.append((source, line, size))
+            if line is not None:
+                self.accounting.added(source, size)
+            self._cond.notify_all()
+
+
+    async def get(self) -> tuple[str, str | None]:
+        async with self._cond:
+            if not self._items:
+                started = time.perf_counter()
+                try:
+                    await self._cond.wait_for(lambda: self._items)
+                finally:
+                    self.accounting.consumer_blocked += time.perf_counter() - started
+            source, line, size = self._items.popleft()
+            if line is not None:
+                self.accounting.removed(source, size)
+            self._cond.notify_all()
+            return source, line
+
+
+    def stats(self) -> dict:
+        return self.accounting.stats()
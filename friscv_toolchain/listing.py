@@ -0,0 +1,62 @@
+import re
+from pathlib import Path
+
+
+FUNC_RE = re.compile(r'^(?P<addr>[0-9a-fA-F]+)\s+<(?P<name>[^>]+)>:')
+INST_RE = re.compile(r'^\s*(?P<addr>[0-9a-fA-F]+):\s+(?P<inst>[0-9a-fA-F]{8})\s+(?P<text>.+)$')
+
+
+class Listing:
+    """
+    Address to function and disassembly lookup from an objdump .lst file.
+    """
+    def __init__(self, entries: dict[int, tuple[str, int, str]]) -> None:
+        self.entries = entries
+
+
+    def annotate(self, pc: int) -> str:
+        """Return '<function+offset> disassembly' for an address, or '' if unknown"""
+        entry = self.entries.get(pc)
+        if entry is None:
+            return ''
+        function, start, text = entry
+        return f'<{function}+{pc - start:#x}> {text}'
+
+
+    def function(self, pc: int) -> str | None:
+        entry = self.entries.get(pc)
+        return entry[0] if entry else None
+
+
+def load_listing(path: Path | str) -> Listing:
+    """
+    Parse the disassembly written by build-tests.sh (objdump -d).
+
+    Args:
+        path: Path to the .lst file
+
+    Returns:
+        Listing with one entry per instruction address
+    """
+    entries = {}
+    function, start = '?', 0
+    with open(path, 'r') as f:
+        for line in f:
+            m = FUNC_RE.match(line)
+            if m:
+                function, start = m.group('name'), int(m.group('addr'), 16)
+                continue
+            m = INST_RE.match(line)
+            if m:
+                text = ' '.join(m.group('text').split())
+                entries[int(m.group('addr'), 16)] = (function, start, text)
+    return Listing(entries)
+
+
+def find_listing(elf_or_trace: Path) -> Path | None:
+    """Locate the .lst of a test from its ELF or trace path in the output tree"""
+    candidates = [
+        elf_or_trace.with_suffix('.lst'),
+        elf_or_trace.parent.parent / 'disasm' / f'{elf_or_trace.stem}.lst',
+    ]
+    return next((c for c in candidates if c.is_file()), None)
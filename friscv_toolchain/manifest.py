@@ -0,0 +1,218 @@
+import fnmatch
+import json
+import re
+from pathlib import Path
+
+
+MANIFEST_NAME = 'manifest.json'
+TEST_PATTERNS = ('test*.c', 'test*.S')
+DEFAULT_ISA = 'rv32i'
+# Keys of a "defaults" or per-test entry: the TestSpec fields a manifest may set
+MANIFEST_KEYS = ('tags', 'max_cycles', 'timeout', 'expect', 'isa')
+
+
+class TestSpec:
+    """
+    One test source and its manifest metadata.
+    """
+    def __init__(
+        self,
+        name: str,
+        source: Path,
+        tags: set[str] | None = None,
+        max_cycles: int | None = None,
+        timeout: float | None = None,
+        expect: str = 'pass',
+        isa: str = DEFAULT_ISA
+    ) -> None:
+        if expect not in ('pass', 'fail'):
+            raise ValueError(f'{name}: expect must be "pass" or "fail", not {expect!r}')
+        self.name = name
+        self.source = source
+        self.tags = tags if tags is not None else set()
+        self.max_cycles = max_cycles
+        self.timeout = timeout
+        self.expect = expect
+        self.isa = isa
+
+
+    def elf_path(self, output_dir: Path) -> Path:
+        return Path(output_dir) / 'bin' / f'{self.name}.elf'
+
+
+def _load_manifest(directory: Path) -> dict:
+    path = directory / MANIFEST_NAME
+    if not path.is_file():
+        return {}
+    with open(path, 'r') as f:
+        try:
+            manifest = json.load(f)
+        except json.JSONDecodeError as e:
+            raise ValueError(f'{path} is not valid JSON: {e}') from e
+
+    for key in manifest:
+        if key not in ('defaults', 'tests'):
+            raise ValueError(f'{path}: unknown key {key!r} (expected "defaults" or "tests")')
+    entries = [('defaults', manifest.get('defaults', {}))]
+    entries += [(f'tests.{name}', entry) for name, entry in manifest.get('tests', {}).items()]
+    for where, entry in entries:
+        for key in entry:
+            if key not in MANIFEST_KEYS:
+                raise ValueError(f'{path}: unknown key {key!r} in {where} (expected one of {", ".join(MANIFEST_KEYS)})')
+    return manifest
+
+
+def discover_tests(test_dir: Path | str) -> list[TestSpec]:
+    """
+    Find every test source below test_dir and attach its metadata.
+
+    Each directory may hold a manifest.json with "defaults" and per-test
+    "tests" entries; a test sees the defaults of every manifest from
+    test_dir down to its own directory, then its own entry. The path
+    components below test_dir become implicit tags.
+
+    Args:
+        test_dir: Root of the test sources
+
+    Returns:
+        Tests sorted by name
+    """
+    root = Path(test_dir).resolve()
+    manifests: dict[Path, dict] = {}
+    tests: dict[str, TestSpec] = {}
+
+    sources = sorted({p for pattern in TEST_PATTERNS for p in root.rglob(pattern) if p.is_file()})
+    for source in sources:
+        parts = source.parent.relative_to(root).parts
+        chain = [root.joinpath(*parts[:depth]) for depth in range(len(parts) + 1)]
+        fields: dict = {}
+        entry: dict = {}
+        for directory in chain:
+            if directory not in manifests:
+                manifests[directory] = _load_manifest(directory)
+            fields.update(manifests[directory].get('defaults', {}))
+            entry = manifests[directory].get('tests', {}).get(source.stem, entry)
+        fields.update(entry)
+
+        name = source.stem
+        if name in tests:
+            raise ValueError(f'Duplicate test name {name}: {tests[name].source} and {source}')
+        tags = set(fields.pop('tags', [])) | set(source.parent.relative_to(root).parts)
+        tests[name] = TestSpec(name, source, tags, **fields)
+
+    return [tests[name] for name in sorted(tests)]
+
+
+_TOKEN_RE = re.compile(r'\s*(?:(?P<op>\(|\)|&|\||!|,)|(?P<word>[^\s()&|!,]+))')
+
+
+def _tokenize(expression: str) -> list[str]:
+    tokens = []
+    position = 0
+    expression = expression.strip()
+    while position < len(expression):
+        m = _TOKEN_RE.match(expression, position)
+        if not m or m.end() == position:
+            raise ValueError(f'Cannot parse selection at: {expression[position:]}')
+        token = m.group('op') or m.group('word')
+        tokens.append({'and': '&', 'or': '|', 'not': '!'}.get(token, token))
+        position = m.end()
+    return tokens
+
+
+def _atom(word: str):
+    """Predicate for one term: a tag glob, or key:glob for name, isa or expect"""
+    key, sep, pattern = word.partition(':')
+    if not sep:
+        return lambda test: any(fnmatch.fnmatchcase(tag, word) for tag in test.tags)
+    if key == 'name':
+        return lambda test: fnmatch.fnmatchcase(test.name, pattern)
+    if key == 'tag':
+        return lambda test: any(fnmatch.fnmatchcase(tag, pattern) for tag in test.tags)
+    if key in ('isa', 'expect'):
+        return lambda test: fnmatch.fnmatchcase(getattr(test, key), pattern)
+    raise ValueError(f'Unknown selection key {key} (expected name, tag, isa or expect)')
+
+
+def parse_selection(expression: str):
+    """
+    Compile a selection expression into a predicate over TestSpec.
+
+    Grammar: terms are tag globs (memory, bench*) or key:glob with key one
+    of name, tag, isa, expect; combine with 'not'/'!', 'and'/'&',
+    'or'/'|'/',' and parentheses. Precedence is not > and > or.
+    Example: "benchmark and not slow, name:test1_*"
+    """
+    tokens = _tokenize(expression)
+    position = 0
+
+    def peek():
+        return tokens[position] if position < len(tokens) else None
+
+    def take():
+        nonlocal position
+        position += 1
+        return tokens[position - 1]
+
+    def parse_or():
+        left = parse_and()
+        while peek() in ('|', ','):
+            take()
+            right = parse_and()
+            left = (lambda a, b: lambda t: a(t) or b(t))(left, right)
+        return left
+
+    def parse_and():
+        left = parse_not()
+        while peek() == '&':
+            take()
+            right = parse_not()
+            left = (lambda a, b: lambda t: a(t) and b(t))(left, right)
+        return left
+
+    def parse_not():
+        if peek() == '!':
+            take()
+            inner = parse_not()
+            return lambda t: not inner(t)
+        return parse_primary()
+
+    def parse_primary():
+        token = peek()
+        if token is None:
+            raise ValueError(f'Unexpected end of selection: {expression}')
+        if token == '(':
+            take()
+            inner = parse_or()
+            if peek() != ')':
+                raise ValueError(f'Missing ) in selection: {expression}')
+            take()
+            return inner
+        if token in (')', '&', '|', ','):
+            raise ValueError(f'Unexpected {token} in selection: {expression}')
+        return _atom(take())
+
+    predicate = parse_or()
+    if position != len(tokens):
+        raise ValueError(f'Unexpected {tokens[position]} in selection: {expression}')
+    return predicate
+
+
+def isa_supported(required: str, available: str = DEFAULT_ISA) -> bool:
+    """Whether every single-letter extension of required is in available (rv32im needs i and m)"""
+    base_required, base_available = required.lower()[:4], available.lower()[:4]
+    return base_required == base_available and set(required.lower()[4:]) <= set(available.lower()[4:])
+
+
+def select_tests(tests: list[TestSpec], expression: str | None = None,
+                 isa: str = DEFAULT_ISA) -> tuple[list[TestSpec], list[TestSpec]]:
+    """
+    Apply a selection expression and the ISA filter.
+
+    Returns:
+        (selected tests, tests matching the expression but needing an unavailable ISA)
+    """
+    predicate = parse_selection(expression) if expression else (lambda test: True)
+    matching = [test for test in tests if predicate(test)]
+    return ([test for test in matching if isa_supported(test.isa, isa)],
+            [test for test in matching if not isa_supported(test.isa, isa)])
@@ -0,0 +1,257 @@
+import argparse
+import json
+import math
+import os
+import resource
+import statistics
+import sys
+import time
+from pathlib import Path
+
+from .compiler import compile_riscv_tests
+from .manifest import TestSpec, discover_tests, select_tests
+from .perf_gate import CONFIDENCE, Metric, SAMPLED_METRICS, metrics_document, save_metrics
+from .perfdb import PerfDB, DEFAULT_DB_PATH
+from .runner import TestResult, run_test
+from .spike_interface import SpikeInterface, SPIKE_OPTS, START_PC, find_spike
+
+
+BUILD_SCRIPT_PATH = Path(__file__).parent.parent / 'build_scripts' / 'build-tests.sh'
+DEFAULT_WARMUP = 1
+DEFAULT_REPEAT = 5
+
+# Per repetition: wall time of the run, the simulator's own rusage (from wait4)
+# and the CPU time the harness spent parsing its output
+SAMPLE_METRICS = ('wall', 'user', 'sys', 'cpu', 'nvcsw', 'nivcsw', 'harness_cpu')
+
+
+def median_ci(samples: list[float], confidence: float = CONFIDENCE) -> tuple[float, float]:
+    """
+    Distribution-free confidence interval of the median from order statistics.
+
+    The narrowest [x(k), x(n-k+1)] whose binomial coverage reaches the
+    confidence; with too few samples for that, the whole sample range.
+    """
+    values = sorted(samples)
+    n = len(values)
+    low, high = values[0], values[-1]
+    for k in range(1, n // 2 + 1):
+        coverage = 1 - 2 * sum(math.comb(n, i) for i in range(k)) / 2 ** n
+        if coverage < confidence:
+            break
+        low, high = values[k - 1], values[n - k]
+    return low, high
+
+
+def pick_cpus(sim_cpu: int | None = None) -> tuple[int | None, int | None]:
+    """
+    A CPU for the simulator and a different one for the harness, out of the
+    CPUs this process may run on. The last allowed CPU goes to the simulator
+    since the first ones tend to take the system's interrupts.
+
+    Returns:
+        (simulator CPU, harness CPU); the harness CPU is None with a single CPU
+    """
+    allowed = sorted(os.sched_getaffinity(0))
+    if sim_cpu is None:
+        sim_cpu = allowed[-1]
+    elif sim_cpu not in allowed:
+        raise ValueError(f'CPU {sim_cpu} is not available to this process (allowed: {allowed})')
+    others = [cpu for cpu in allowed if cpu != sim_cpu]
+    return sim_cpu, others[-1] if others else None
+
+
+def cpu_governor(cpu: int) -> str | None:
+    try:
+        return Path(f'/sys/devices/system/cpu/cpu{cpu}/cpufreq/scaling_governor').read_text().strip()
+    except OSError:
+        return None
+
+
+class Measurement:
+    """
+    Warm-up and timed repetitions of one test, with a sample list per metric.
+    """
+    def __init__(self, spec: TestSpec) -> None:
+        self.spec = spec
+        self.samples: dict[str, list[float]] = {metric: [] for metric in SAMPLE_METRICS}
+        self.statuses: list[str] = []
+        self.instret: set[int] = set()
+        self.result: TestResult | None = None
+
+
+    @property
+    def status(self) -> str:
+        """The test's status, or 'unstable' if repetitions disagree on status or instruction count"""
+        if len(set(self.statuses)) > 1 or len(self.instret) > 1:
+            return 'unstable'
+        return self.statuses[0] if self.statuses else 'error'
+
+
+    def add(self, result: TestResult, wall: float, usage, harness_cpu: float) -> None:
+        self.result = result
+        self.statuses.append(result.status)
+        self.instret.add(result.instret)
+        self.samples['wall'].append(wall)
+        self.samples['harness_cpu'].append(harness_cpu)
+        if usage is not None:
+            self.samples['user'].append(usage.ru_utime)
+            self.samples['sys'].append(usage.ru_stime)
+            self.samples['cpu'].append(usage.ru_utime + usage.ru_stime)
+            self.samples['nvcsw'].append(usage.ru_nvcsw)
+            self.samples['nivcsw'].append(usage.ru_nivcsw)
+
+
+def measure_test(spec: TestSpec, elf_path: Path, spike_cmd: str, warmup: int = DEFAULT_WARMUP,
+                 repeat: int = DEFAULT_REPEAT, cpu: int | None = None) -> Measurement:
+    """
+    Run a test warmup times untimed, then repeat times timed, each in a fresh
+    Spike process pinned to cpu.
+    """
+    measurement = Measurement(spec)
+    for i in range(warmup + repeat):
+        spike = SpikeInterface(spike_cmd, spec.isa, SPIKE_OPTS, START_PC, str(elf_path), verbose=False, cpu=cpu)
+        before = resource.getrusage(resource.RUSAGE_SELF)
+        started = time.perf_counter()
+        result = run_test(spike, max_cycles=spec.max_cycles, timeout=spec.timeout)
+        wall = time.perf_counter() - started
+        after = resource.getrusage(resource.RUSAGE_SELF)
+        if i >= warmup:
+            harness_cpu = (after.ru_utime - before.ru_utime) + (after.ru_stime - before.ru_stime)
+            measurement.add(result, wall, spike.rusage, harness_cpu)
+    # The stored result carries the median wall time rather than the last repetition's
+    measurement.result.phases = {'simulate': statistics.median(measurement.samples['wall'])}
+    return measurement
+
+
+def measure_tests(tests: list[TestSpec], build_dir: Path, spike_cmd: str, warmup: int = DEFAULT_WARMUP,
+                  repeat: int = DEFAULT_REPEAT, sim_cpu: int | None = None, pin: bool = True) -> list[Measurement]:
+    """
+    Measure every test in turn, the simulator pinned to one CPU and this
+    process to another, restoring this process's affinity afterwards.
+    """
+    original = os.sched_getaffinity(0)
+    cpu = None
+    if pin:
+        cpu, harness_cpu = pick_cpus(sim_cpu)
+        if harness_cpu is None:
+            print('Only one CPU available: the simulator and the harness share it', file=sys.stderr)
+        else:
+            os.sched_setaffinity(0, {harness_cpu})
+        governor = cpu_governor(cpu)
+        if governor not in (None, 'performance'):
+            print(f'CPU {cpu} uses the {governor} governor; timings vary with its frequency', file=sys.stderr)
+        print(f'Simulator on CPU {cpu}, harness on CPU {harness_cpu}', file=sys.stderr)
+
+    measurements = []
+    try:
+        for spec in tests:
+            print(f'Measuring {spec.name}: {warmup} warm-up + {repeat} timed runs', file=sys.stderr)
+            measurements.append(measure_test(spec, spec.elf_path(build_dir), spike_cmd, warmup, repeat, cpu))
+    finally:
+        os.sched_setaffinity(0, original)
+    return measurements
+
+
+def gate_metrics(measurements: list[Measurement]) -> dict[str, Metric]:
+    """The sampled metrics of passing tests, named as metrics_from_db names them"""
+    metrics = {}
+    for m in measurements:
+        if m.status != 'pass':
+            continue
+        for metric, (prefix, unit) in SAMPLED_METRICS.items():
+            if m.samples[metric]:
+                metrics[f'{prefix}/{m.spec.name}'] = Metric(f'{prefix}/{m.spec.name}', m.samples[metric],
+                                                            'lower', unit, True)
+    return metrics
+
+
+def format_report(measurements: list[Measurement]) -> str:
+    lines = [f'Medians with {CONFIDENCE:.0%} confidence intervals',
+             f'{"test":24} {"status":8} {"instret":>9}  {"wall ms":^26}  {"user ms":>8} {"sys ms":>7} '
+             f'{"harness ms":>10} {"csw":>5} {"icsw":>5}  {"CI":>6}']
+    for m in measurements:
+        wall = m.samples['wall']
+        low, high = median_ci(wall)
+        median = statistics.median(wall)
+        spread = (high - low) / median if median else 0.0
+        cells = [f'{1000 * statistics.median(m.samples[key]):>{width}.1f}' if m.samples[key] else f'{"-":>{width}}'
+                 for key, width in (('user', 8), ('sys', 7), ('harness_cpu', 10))]
+        switches = [f'{statistics.median(m.samples[key]):>5.0f}' if m.samples[key] else f'{"-":>5}'
+                    for key in ('nvcsw', 'nivcsw')]
+        instret = ','.join(str(i) for i in sorted(m.instret))
+        lines.append(f'{m.spec.name:24} {m.status:8} {instret:>9}  {1000 * median:8.1f} '
+                     f'[{1000 * low:7.1f}, {1000 * high:7.1f}]  {" ".join(cells)} {" ".join(switches)}'
+                     f'  ±{spread / 2:>5.1%}')
+    return '\n'.join(lines)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description='Reproducible host timings: pinned Spike runs with warm-up, repetitions and rusage'
+    )
+    parser.add_argument('--test-dir', type=Path, default=Path('./test_sources'))
+    parser.add_argument('--select', metavar='EXPR', help='Manifest selection expression')
+    parser.add_argument('--output', type=Path, default=Path('./output/measure'), help='Build directory')
+    parser.add_argument('--no-build', action='store_true', help='Reuse the ELFs already in --output')
+    parser.add_argument('--warmup', type=int, default=DEFAULT_WARMUP, help='Untimed runs before timing')
+    parser.add_argument('--repeat', type=int, default=DEFAULT_REPEAT, help='Timed runs per test')
+    parser.add_argument('--cpu', type=int, help='CPU for the simulator (default: the last one available)')
+    parser.add_argument('--no-pin', action='store_true', help='Leave CPU placement to the scheduler')
+    parser.add_argument('--spike-path', help='Custom path to Spike simulator')
+    parser.add_argument('--riscv-tools-path', help='Custom path to RISC-V toolchain')
+    parser.add_argument('--perf-db', type=Path, default=DEFAULT_DB_PATH, help='Performance database')
+    parser.add_argument('--no-perf-db', action='store_true', help='Do not record the measurements')
+    parser.add_argument('--metrics', type=Path,
+                        help='Write the gate metrics JSON here instead of stdout')
+    args = parser.parse_args()
+
+    if args.repeat < 1 or args.warmup < 0:
+        parser.error('--repeat must be at least 1 and --warmup not negative')
+    spike_cmd = find_spike(args.spike_path)
+    if not spike_cmd:
+        parser.error('Spike not found; give --spike-path')
+
+    tests, unsupported = select_tests(discover_tests(args.test_dir.resolve()), args.select)
+    for spec in unsupported:
+        print(f'Skipping {spec.name}: needs {spec.isa}', file=sys.stderr)
+    if not tests:
+        parser.error('No tests selected')
+
+    build_dir = args.output.resolve()
+    run_phases = {}
+    if not args.no_build:
+        started = time.perf_counter()
+        if not compile_riscv_tests(BUILD_SCRIPT_PATH, args.test_dir.resolve(), build_dir, args.riscv_tools_path,
+                                   tests=[spec.source for spec in tests]):
+            print('Building the tests failed', file=sys.stderr)
+            raise SystemExit(1)
+        run_phases['compile'] = time.perf_counter() - started
+
+    try:
+        measurements = measure_tests(tests, build_dir, spike_cmd, args.warmup, args.repeat, args.cpu,
+                                     not args.no_pin)
+    except ValueError as e:
+        parser.error(str(e))
+    print(format_report(measurements), file=sys.stderr)
+
+    if not args.no_perf_db:
+        db = PerfDB(args.perf_db)
+        notes = f'measure: warmup {args.warmup}, repeat {args.repeat}, ' + \
+                ('unpinned' if args.no_pin else f'cpu {args.cpu if args.cpu is not None else pick_cpus()[0]}')
+        run_id = db.record_run([m.result for m in measurements], run_phases=run_phases, notes=notes,
+                               samples={m.spec.name: m.samples for m in measurements})
+        print(f'Recorded run {run_id} in {db.path}', file=sys.stderr)
+        db.close()
+
+    metrics = gate_metrics(measurements)
+    if args.metrics:
+        save_metrics(metrics, args.metrics)
+    else:
+        print(json.dumps(metrics_document(metrics), indent=2))
+    if any(m.status != m.spec.expect for m in measurements):
+        raise SystemExit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,326 @@
+import argparse
+import json
+import random
+import statistics
+import subprocess
+import sys
+from pathlib import Path
+
+from .perfdb import PerfDB, DEFAULT_DB_PATH
+
+
+DEFAULT_BASELINE_PATH = Path('./output/perf-baseline.json')
+METRICS_FORMAT = 1
+
+# Relative change in the bad direction that counts as a regression
+DEFAULT_THRESHOLD = 0.01
+DEFAULT_NOISY_THRESHOLD = 0.05
+
+BOOTSTRAP_ROUNDS = 2000
+CONFIDENCE = 0.95
+
+# Repeated host-time samples stored by the measurement mode, gated as noisy metrics
+SAMPLED_METRICS = {'wall': ('wall_time', 's'), 'cpu': ('cpu_time', 's')}
+
+
+class Metric:
+    """
+    Samples of one measured quantity and the direction that counts as better.
+    """
+    def __init__(self, name: str, samples: list[float], better: str = 'lower',
+                 unit: str = '', noisy: bool | None = None) -> None:
+        if better not in ('lower', 'higher'):
+            raise ValueError(f'{name}: better must be "lower" or "higher", not {better!r}')
+        self.name = name
+        self.samples = [float(s) for s in samples]
+        self.better = better
+        self.unit = unit
+        # Deterministic metrics (simulated cycles) are exact; anything sampled repeatedly is not
+        self.noisy = len(self.samples) > 1 if noisy is None else noisy
+
+
+    @property
+    def median(self) -> float:
+        return statistics.median(self.samples)
+
+
+    def to_json(self) -> dict:
+        return {'samples': self.samples, 'better': self.better, 'unit': self.unit, 'noisy': self.noisy}
+
+
+def load_metrics(path: Path | str) -> dict[str, Metric]:
+    """
+    Read a metrics file: {"format": 1, "metrics": {name: {"samples": [...], "better": ...}}}.
+    """
+    with open(path, 'r') as f:
+        data = json.load(f)
+    return {name: Metric(name, **fields) for name, fields in data.get('metrics', {}).items()}
+
+
+def metrics_document(metrics: dict[str, Metric]) -> dict:
+    return {'format': METRICS_FORMAT, 'metrics': {name: m.to_json() for name, m in sorted(metrics.items())}}
+
+
+def save_metrics(metrics: dict[str, Metric], path: Path | str) -> None:
+    path = Path(path)
+    path.parent.mkdir(parents=True, exist_ok=True)
+    with open(path, 'w') as f:
+        json.dump(metrics_document(metrics), f, indent=2)
+
+
+def merge_metrics(target: dict[str, Metric], new: dict[str, Metric]) -> None:
+    """Append the samples of new to the metrics of the same name in target"""
+    for name, metric in new.items():
+        if name in target:
+            target[name].samples += metric.samples
+            target[name].noisy = target[name].noisy or len(target[name].samples) > 1
+        else:
+            target[name] = metric
+
+
+def _resolve_run(db: PerfDB, run_id: int | None) -> int | None:
+    if run_id is None:
+        latest = db.latest_runs(1)
+        return latest[0] if latest else None
+    return run_id
+
+
+def metrics_from_db(db: PerfDB, run_id: int | None = None) -> dict[str, Metric]:
+    """
+    Per-test simulated cycles (instret when the simulator has no timing) of one
+    run, plus wall and CPU time when the run was a repeated measurement.
+    Tests that did not pass have no metrics (see failing_tests_from_db).
+    """
+    run_id = _resolve_run(db, run_id)
+    if run_id is None:
+        return {}
+    metrics = {}
+    samples = db.samples(run_id)
+    for test, row in db.results(run_id).items():
+        if row['status'] != 'pass':
+            continue
+        if row['cycles'] is not None:
+            metrics[f'cycles/{test}'] = Metric(f'cycles/{test}', [row['cycles']], 'lower', 'cycles', False)
+        elif row['instret']:
+            metrics[f'instret/{test}'] = Metric(f'instret/{test}', [row['instret']], 'lower', 'instructions', False)
+        for metric, (prefix, unit) in SAMPLED_METRICS.items():
+            values = samples.get(test, {}).get(metric)
+            if values:
+                metrics[f'{prefix}/{test}'] = Metric(f'{prefix}/{test}', values, 'lower', unit, True)
+    return metrics
+
+
+def failing_tests_from_db(db: PerfDB, run_id: int | None = None) -> dict[str, str]:
+    """Status of every test of one run that did not pass"""
+    run_id = _resolve_run(db, run_id)
+    if run_id is None:
+        return {}
+    return {test: row['status'] for test, row in db.results(run_id).items() if row['status'] != 'pass'}
+
+
+def measure(command: list[str], repeat: int) -> dict[str, Metric]:
+    """
+    Run a command that prints a metrics JSON document repeat times and pool the samples.
+    """
+    metrics: dict[str, Metric] = {}
+    for i in range(repeat):
+        print(f'Sample {i + 1}/{repeat}: {" ".join(command)}', file=sys.stderr)
+        output = subprocess.run(command, capture_output=True, text=True, check=True).stdout
+        data = json.loads(output)
+        merge_metrics(metrics, {name: Metric(name, **fields) for name, fields in data['metrics'].items()})
+    return metrics
+
+
+def bootstrap_change(baseline: list[float], current: list[float], seed: int = 0) -> tuple[float, float]:
+    """
+    Confidence interval of the relative change of the median from baseline to current.
+
+    Returns:
+        (low, high) bounds of (median(current) - median(baseline)) / median(baseline)
+    """
+    rng = random.Random(seed)
+    changes = []
+    for _ in range(BOOTSTRAP_ROUNDS):
+        base = statistics.median(rng.choices(baseline, k=len(baseline)))
+        cur = statistics.median(rng.choices(current, k=len(current)))
+        changes.append((cur - base) / base if base else 0.0)
+    changes.sort()
+    tail = (1 - CONFIDENCE) / 2
+    return changes[int(tail * len(changes))], changes[min(len(changes) - 1, int((1 - tail) * len(changes)))]
+
+
+def compare(
+    baseline: dict[str, Metric],
+    current: dict[str, Metric],
+    threshold: float = DEFAULT_THRESHOLD,
+    noisy_threshold: float = DEFAULT_NOISY_THRESHOLD,
+    overrides: dict[str, float] | None = None,
+    allow_missing: bool = False
+) -> dict:
+    """
+    Compare current metrics against a baseline.
+
+    A deterministic metric regresses when its relative change in the bad
+    direction exceeds the threshold. A noisy metric regresses only when the
+    whole bootstrap confidence interval of the change of its median lies past
+    the threshold. A baseline metric missing from the current run (usually a
+    test that no longer passes) fails the gate unless allow_missing is set.
+
+    Args:
+        baseline: Stored baseline metrics
+        current: Metrics of the run under test
+        threshold: Allowed relative change for deterministic metrics
+        noisy_threshold: Allowed relative change for sampled metrics
+        overrides: Per-metric thresholds, matched on name or name prefix
+        allow_missing: Pass even if baseline metrics are missing from current
+
+    Returns:
+        Verdict dictionary with 'verdict', ranked 'regressions', 'improvements',
+        'unchanged', 'missing' and 'new' metric names
+    """
+    overrides = overrides or {}
+    regressions, improvements, unchanged = [], [], []
+
+    for name in sorted(set(baseline) & set(current)):
+        base, cur = baseline[name], current[name]
+        # Express every change so that positive means worse
+        sign = 1 if cur.better == 'lower' else -1
+        noisy = base.noisy or cur.noisy
+        limit = next((v for k, v in sorted(overrides.items(), key=lambda kv: -len(kv[0])) if name.startswith(k)),
+                     noisy_threshold if noisy else threshold)
+
+        change = (cur.median - base.median) / base.median if base.median else 0.0
+        low = high = change
+        if noisy and (len(base.samples) > 1 or len(cur.samples) > 1):
+            low, high = bootstrap_change(base.samples, cur.samples)
+        worse_low, worse_high = sorted((sign * low, sign * high))
+
+        entry = {
+            'metric': name,
+            'baseline': base.median,
+            'current': cur.median,
+            'change': change,
+            'ci': [low, high] if noisy else None,
+            'threshold': limit,
+            'unit': cur.unit,
+        }
+        if worse_low > limit:
+            regressions.append(entry)
+        elif worse_high < -limit:
+            improvements.append(entry)
+        else:
+            unchanged.append(name)
+
+    regressions.sort(key=lambda e: abs(e['change']), reverse=True)
+    improvements.sort(key=lambda e: abs(e['change']), reverse=True)
+    missing = sorted(set(baseline) - set(current))
+    return {
+        'verdict': 'fail' if regressions or (missing and not allow_missing) else 'pass',
+        'regressions': regressions,
+        'improvements': improvements,
+        'unchanged': unchanged,
+        'missing': missing,
+        'new': sorted(set(current) - set(baseline)),
+    }
+
+
+def _format_entry(entry: dict) -> str:
+    line = f'{entry["metric"]:40} {entry["baseline"]:>12.4g} -> {entry["current"]:>12.4g} {entry["unit"]:12} ' \
+           f'{entry["change"]:+.2%}'
+    if entry['ci']:
+        line += f'  (CI {entry["ci"][0]:+.2%} .. {entry["ci"][1]:+.2%})'
+    return line + f'  [limit {entry["threshold"]:.1%}]'
+
+
+def _parse_override(text: str) -> tuple[str, float]:
+    name, sep, value = text.partition('=')
+    if not sep:
+        raise argparse.ArgumentTypeError(f'Expected METRIC=THRESHOLD, got {text}')
+    return name, float(value)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description='Fail when simulated cycles or toolchain throughput regress against a stored baseline'
+    )
+    source = parser.add_argument_group('Current Measurements')
+    source.add_argument('--metrics', type=Path, action='append', default=[],
+                        help='Metrics JSON file (may be given more than once)')
+    source.add_argument('--from-db', nargs='?', const=DEFAULT_DB_PATH, type=Path, metavar='DB_PATH',
+                        help='Take per-test cycles from the performance database')
+    source.add_argument('--run', type=int, help='Run id in the database (default: latest)')
+    source.add_argument('--repeat', type=int, default=0, metavar='N',
+                        help='Run the measurement command N times and pool its samples')
+    source.add_argument('command', nargs=argparse.REMAINDER,
+                        help='Measurement command printing a metrics JSON document (after --)')
+
+    gate = parser.add_argument_group('Gate')
+    gate.add_argument('--baseline', type=Path, default=DEFAULT_BASELINE_PATH, help='Baseline metrics file')
+    gate.add_argument('--threshold', type=float, default=DEFAULT_THRESHOLD,
+                      help='Allowed relative regression of deterministic metrics')
+    gate.add_argument('--noisy-threshold', type=float, default=DEFAULT_NOISY_THRESHOLD,
+                      help='Allowed relative regression of sampled (wall-time) metrics')
+    gate.add_argument('--threshold-for', type=_parse_override, action='append', default=[], metavar='METRIC=T',
+                      help='Threshold for one metric or metric prefix (e.g. cycles/=0)')
+    gate.add_argument('--allow-missing', action='store_true',
+                      help='Pass even if baseline metrics are missing from this run (e.g. a test stopped passing)')
+    gate.add_argument('--update-baseline', action='store_true',
+                      help='Store the current measurements as the new baseline instead of gating')
+    gate.add_argument('--verdict', type=Path, help='Also write the verdict JSON to this file')
+    args = parser.parse_args()
+
+    command = args.command[1:] if args.command[:1] == ['--'] else args.command
+    if args.repeat and not command:
+        parser.error('--repeat needs a measurement command after --')
+
+    current: dict[str, Metric] = {}
+    failing: dict[str, str] = {}
+    for path in args.metrics:
+        merge_metrics(current, load_metrics(path))
+    if args.from_db:
+        db = PerfDB(args.from_db)
+        merge_metrics(current, metrics_from_db(db, args.run))
+        failing = failing_tests_from_db(db, args.run)
+        db.close()
+    if command:
+        merge_metrics(current, measure(command, max(args.repeat, 1)))
+    if not current:
+        parser.error('No measurements: give --metrics, --from-db or a measurement command')
+
+    if args.update_baseline:
+        save_metrics(current, args.baseline)
+        print(f'Baseline with {len(current)} metrics written to {args.baseline}', file=sys.stderr)
+        return
+
+    if not args.baseline.is_file():
+        print(f'No baseline at {args.baseline}; create one with --update-baseline', file=sys.stderr)
+        sys.exit(2)
+
+    verdict = compare(load_metrics(args.baseline), current, args.threshold, args.noisy_threshold,
+                      dict(args.threshold_for), args.allow_missing)
+    verdict['failing_tests'] = failing
+
+    for title, key in (('Regressions', 'regressions'), ('Improvements', 'improvements')):
+        if verdict[key]:
+            print(f'{title}:', file=sys.stderr)
+            for entry in verdict[key]:
+                print(f'  {_format_entry(entry)}', file=sys.stderr)
+    if failing:
+        print(f'Not passing in this run: {", ".join(f"{test} ({status})" for test, status in sorted(failing.items()))}',
+              file=sys.stderr)
+    if verdict['missing']:
+        print(f'Missing from this run: {", ".join(verdict["missing"])}'
+              + (' (allowed)' if args.allow_missing else ''), file=sys.stderr)
+    print(f'Verdict: {verdict["verdict"].upper()} ({len(verdict["regressions"])} regressions, '
+          f'{len(verdict["missing"])} missing, {len(verdict["unchanged"])} unchanged)', file=sys.stderr)
+
+    if args.verdict:
+        with open(args.verdict, 'w') as f:
+            json.dump(verdict, f, indent=2)
+    print(json.dumps(verdict, indent=2))
+
+    sys.exit(1 if verdict['verdict'] == 'fail' else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,261 @@
+import argparse
+import datetime
+import hashlib
+import socket
+import sqlite3
+import subprocess
+from pathlib import Path
+
+from .runner import TestResult
+
+
+DEFAULT_DB_PATH = Path('./output/perf.sqlite')
+
+SCHEMA = """
+CREATE TABLE IF NOT EXISTS runs (
+    id INTEGER PRIMARY KEY AUTOINCREMENT,
+    started TEXT NOT NULL,
+    toolchain_version TEXT NOT NULL,
+    design_hash TEXT NOT NULL,
+    host TEXT NOT NULL,
+    notes TEXT
+);
+CREATE TABLE IF NOT EXISTS results (
+    run_id INTEGER NOT NULL REFERENCES runs(id),
+    test TEXT NOT NULL,
+    elf_hash TEXT NOT NULL,
+    status TEXT NOT NULL,
+    instret INTEGER,
+    cycles INTEGER,
+    cpi REAL,
+    wall_time REAL,
+    PRIMARY KEY (run_id, test)
+);
+CREATE TABLE IF NOT EXISTS phases (
+    run_id INTEGER NOT NULL REFERENCES runs(id),
+    test TEXT NOT NULL,
+    phase TEXT NOT NULL,
+    seconds REAL NOT NULL
+);
+CREATE TABLE IF NOT EXISTS samples (
+    run_id INTEGER NOT NULL REFERENCES runs(id),
+    test TEXT NOT NULL,
+    metric TEXT NOT NULL,
+    repetition INTEGER NOT NULL,
+    value REAL NOT NULL,
+    PRIMARY KEY (run_id, test, metric, repetition)
+);
+CREATE INDEX IF NOT EXISTS results_by_test ON results(test, run_id);
+"""
+
+METRICS = ['instret', 'cycles', 'cpi', 'wall_time']
+
+
+def file_hash(path: Path | str) -> str:
+    digest = hashlib.sha256()
+    with open(path, 'rb') as f:
+        for chunk in iter(lambda: f.read(1 << 20), b''):
+            digest.update(chunk)
+    return digest.hexdigest()[:16]
+
+
+def tree_hash(root: Path | str | None) -> str:
+    """Hash of every file under a directory (names and contents), '' if not given"""
+    if not root:
+        return ''
+    digest = hashlib.sha256()
+    for path in sorted(p for p in Path(root).rglob('*') if p.is_file()):
+        digest.update(str(path.relative_to(root)).encode())
+        digest.update(file_hash(path).encode())
+    return digest.hexdigest()[:16]
+
+
+def toolchain_version() -> str:
+    """Git revision of the toolchain checkout, with a '+dirty' suffix for local changes"""
+    repo = Path(__file__).parent.parent
+    try:
+        rev = subprocess.run(['git', 'rev-parse', '--short', 'HEAD'], cwd=repo,
+                             capture_output=True, text=True, check=True).stdout.strip()
+        dirty = subprocess.run(['git', 'status', '--porcelain', '--untracked-files=no'], cwd=repo,
+                               capture_output=True, text=True, check=True).stdout.strip()
+        return rev + ('+dirty' if dirty else '')
+    except (subprocess.CalledProcessError, FileNotFoundError):
+        return 'unknown'
+
+
+class PerfDB:
+    """
+    Local SQLite history of per-test results, one row per test per run.
+    """
+    def __init__(self, path: Path | str = DEFAULT_DB_PATH) -> None:
+        self.path = Path(path)
+        self.path.parent.mkdir(parents=True, exist_ok=True)
+        self.conn = sqlite3.connect(self.path)
+        self.conn.row_factory = sqlite3.Row
+        self.conn.executescript(SCHEMA)
+
+
+    def record_run(
+        self,
+        results: list[TestResult],
+        design_hash: str = '',
+        run_phases: dict[str, float] | None = None,
+        notes: str | None = None,
+        samples: dict[str, dict[str, list[float]]] | None = None
+    ) -> int:
+        """
+        Store all results of a run in a single transaction.
+
+        Args:
+            results: Per-test results
+            design_hash: Hash of the RTL sources the run used
+            run_phases: Run-level phase times (e.g. compile), stored with test ''
+            notes: Free-form description
+            samples: Repeated measurements, {test: {metric: [value per repetition]}}
+
+        Returns:
+            The new run id
+        """
+        started = datetime.datetime.now().isoformat(timespec='seconds')
+        with self.conn:
+            cursor = self.conn.execute(
+                'INSERT INTO runs (started, toolchain_version, design_hash, host, notes) VALUES (?, ?, ?, ?, ?)',
+                (started, toolchain_version(), design_hash, socket.gethostname(), notes)
+            )
+            run_id = cursor.lastrowid
+            self.conn.executemany(
+                'INSERT OR REPLACE INTO results VALUES (?, ?, ?, ?, ?, ?, ?, ?)',
+                [(run_id, r.name, file_hash(r.elf_path) if Path(r.elf_path).is_file() else '', r.status,
+                  r.instret, r.cycles, r.cpi, sum(r.phases.values())) for r in results]
+            )
+            phases = [(run_id, r.name, phase, seconds) for r in results for phase, seconds in r.phases.items()]
+            phases += [(run_id, '', phase, seconds) for phase, seconds in (run_phases or {}).items()]
+            self.conn.executemany('INSERT INTO phases VALUES (?, ?, ?, ?)', phases)
+            self.conn.executemany(
+                'INSERT OR REPLACE INTO samples VALUES (?, ?, ?, ?, ?)',
+                [(run_id, test, metric, i, value) for test, metrics in (samples or {}).items()
+                 for metric, values in metrics.items() for i, value in enumerate(values)]
+            )
+        return run_id
+
+
+    def runs(self, limit: int = 20) -> list[sqlite3.Row]:
+        return self.conn.execute(
+            "SELECT r.*, COUNT(t.test) AS tests, SUM(t.status = 'pass') AS passed "
+            'FROM runs r LEFT JOIN results t ON t.run_id = r.id GROUP BY r.id ORDER BY r.id DESC LIMIT ?',
+            (limit,)
+        ).fetchall()
+
+
+    def latest_runs(self, count: int = 2) -> list[int]:
+        rows = self.conn.execute('SELECT id FROM runs ORDER BY id DESC LIMIT ?', (count,)).fetchall()
+        return [row['id'] for row in reversed(rows)]
+
+
+    def results(self, run_id: int) -> dict[str, sqlite3.Row]:
+        rows = self.conn.execute('SELECT * FROM results WHERE run_id = ?', (run_id,)).fetchall()
+        return {row['test']: row for row in rows}
+
+
+    def samples(self, run_id: int) -> dict[str, dict[str, list[float]]]:
+        """Repeated measurements of a run, {test: {metric: [value per repetition]}}"""
+        samples: dict[str, dict[str, list[float]]] = {}
+        for row in self.conn.execute('SELECT test, metric, value FROM samples WHERE run_id = ? '
+                                     'ORDER BY test, metric, repetition', (run_id,)):
+            samples.setdefault(row['test'], {}).setdefault(row['metric'], []).append(row['value'])
+        return samples
+
+
+    def trend(self, test: str, limit: int = 20) -> list[sqlite3.Row]:
+        return self.conn.execute(
+            'SELECT r.id, r.started, r.toolchain_version, r.design_hash, t.* FROM results t '
+            'JOIN runs r ON r.id = t.run_id WHERE t.test = ? ORDER BY r.id DESC LIMIT ?',
+            (test, limit)
+        ).fetchall()[::-1]
+
+
+    def deltas(self, run_a: int, run_b: int, metric: str = 'cycles') -> list[tuple[str, float, float, float]]:
+        """
+        Per-test change of a metric between two runs, largest relative change first.
+
+        Returns:
+            (test, value in run_a, value in run_b, relative change)
+        """
+        if metric not in METRICS:
+            raise ValueError(f'Unknown metric {metric}; expected one of {METRICS}')
+        a, b = self.results(run_a), self.results(run_b)
+        changes = []
+        for test in sorted(set(a) & set(b)):
+            old, new = a[test][metric], b[test][metric]
+            if old is None or new is None:
+                continue
+            relative = (new - old) / old if old else (0.0 if new == old else float('inf'))
+            changes.append((test, old, new, relative))
+        return sorted(changes, key=lambda c: abs(c[3]), reverse=True)
+
+
+    def close(self) -> None:
+        self.conn.close()
+
+
+def _fmt(value) -> str:
+    if value is None:
+        return '-'
+    if isinstance(value, float):
+        return f'{value:.4g}'
+    return str(value)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description='Query the FRISC-V performance history')
+    parser.add_argument('--db', type=Path, default=DEFAULT_DB_PATH, help='Path to the performance database')
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    runs_cmd = sub.add_parser('runs', help='List recent runs')
+    runs_cmd.add_argument('--limit', type=int, default=20)
+
+    trend_cmd = sub.add_parser('trend', help='Show the history of one test')
+    trend_cmd.add_argument('test', help='Test name (e.g. test7_bubble_sort)')
+    trend_cmd.add_argument('--limit', type=int, default=20)
+
+    delta_cmd = sub.add_parser('deltas', help='Largest per-test changes between two runs (default: last two)')
+    delta_cmd.add_argument('runs', nargs='*', type=int, metavar='RUN_ID')
+    delta_cmd.add_argument('--metric', choices=METRICS, default='cycles')
+    delta_cmd.add_argument('--top', type=int, default=10)
+
+    args = parser.parse_args()
+    db = PerfDB(args.db)
+
+    if args.command == 'runs':
+        print(f'{"run":>5}  {"started":19}  {"toolchain":14}  {"design":16}  {"passed":>9}')
+        for row in db.runs(args.limit):
+            print(f'{row["id"]:>5}  {row["started"]:19}  {row["toolchain_version"]:14}  '
+                  f'{row["design_hash"] or "-":16}  {row["passed"] or 0:>4}/{row["tests"]:<4}')
+
+    elif args.command == 'trend':
+        rows = db.trend(args.test, args.limit)
+        if not rows:
+            print(f'No results for {args.test}')
+        previous = None
+        for row in rows:
+            change = ''
+            if previous and previous['cycles'] and row['cycles']:
+                change = f'{(row["cycles"] - previous["cycles"]) / previous["cycles"]:+.1%}'
+            print(f'run {row["id"]:>4}  {row["started"]}  {row["status"]:7}  instret {_fmt(row["instret"]):>9}  '
+                  f'cycles {_fmt(row["cycles"]):>9} {change:>7}  cpi {_fmt(row["cpi"]):>6}  '
+                  f'wall {_fmt(row["wall_time"])}s  [{row["toolchain_version"]}]')
+            previous = row
+
+    elif args.command == 'deltas':
+        run_ids = args.runs or db.latest_runs(2)
+        if len(run_ids) != 2:
+            parser.error('Need two runs to compare')
+        print(f'{args.metric}: run {run_ids[0]} -> run {run_ids[1]}')
+        for test, old, new, relative in db.deltas(run_ids[0], run_ids[1], args.metric)[:args.top]:
+            print(f'  {test:32} {_fmt(old):>10} -> {_fmt(new):>10}  {relative:+.1%}')
+
+    db.close()
+
+
+if __name__ == '__main__':
+    main()
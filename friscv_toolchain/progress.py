@@ -0,0 +1,227 @@
+import os
+import sys
+import threading
+import time
+from pathlib import Path
+
+
+DEFAULT_INTERVAL = 5.0
+# A running test with no commit for this long is reported as stalled
+DEFAULT_STALL_SECONDS = 30.0
+STATUSES = ('pass', 'fail', 'timeout', 'error', 'cancelled')
+
+
+class _Worker:
+    def __init__(self, test: str, backend: str) -> None:
+        self.test = test
+        self.backend = backend
+        self.started = time.monotonic()
+        self.commits = 0
+        self.last_commits = 0
+        self.last_progress = self.started
+
+
+def _label(value: str) -> str:
+    return str(value).replace('\\', '\\\\').replace('"', '\\"').replace('\n', '\\n')
+
+
+def _duration(seconds: float) -> str:
+    seconds = int(seconds)
+    if seconds >= 3600:
+        return f'{seconds // 3600}h{seconds % 3600 // 60:02d}m'
+    if seconds >= 60:
+        return f'{seconds // 60}m{seconds % 60:02d}s'
+    return f'{seconds}s'
+
+
+class ProgressTracker:
+    """
+    Live view of a regression: tests finished by status, commits per second
+    per backend, what every worker is running and for how long, and how many
+    tests are still queued.
+
+    Workers report through test_started/commit/test_finished; commit only
+    bumps a counter, so it is cheap enough to call for every instruction. A
+    background thread periodically rewrites an OpenMetrics text file (for the
+    node_exporter textfile collector or just for cat) and prints a status line.
+    """
+    def __init__(self, total: int, metrics_path: Path | str | None = None, status: bool = True,
+                 interval: float = DEFAULT_INTERVAL, stall_seconds: float = DEFAULT_STALL_SECONDS,
+                 stream=sys.stderr) -> None:
+        self.total = total
+        self.metrics_path = Path(metrics_path) if metrics_path else None
+        self.status = status
+        self.interval = interval
+        self.stall_seconds = stall_seconds
+        self.stream = stream
+        self.started = time.monotonic()
+        self.finished: dict[str, int] = dict.fromkeys(STATUSES, 0)
+        self.finished_seconds = 0.0
+        self.commits: dict[str, int] = {}
+        self.rates: dict[str, float] = {}
+        self.workers: dict[str, _Worker] = {}
+        self._lock = threading.Lock()
+        self._stop = threading.Event()
+        self._thread: threading.Thread | None = None
+        self._last_tick = self.started
+        self._last_commits: dict[str, int] = {}
+        self._tty = hasattr(stream, 'isatty') and stream.isatty()
+
+
+    def start(self) -> None:
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        self._thread.start()
+
+
+    def stop(self) -> None:
+        """Stop the background thread and write the final metrics and status line"""
+        self._stop.set()
+        if self._thread is not None:
+            self._thread.join()
+        self.tick()
+        if self.status and self._tty:
+            self.stream.write('\n')
+            self.stream.flush()
+
+
+    def __enter__(self) -> 'ProgressTracker':
+        self.start()
+        return self
+
+
+    def __exit__(self, *exc) -> None:
+        self.stop()
+
+
+    def test_started(self, worker: str | int, test: str, backend: str = 'spike') -> None:
+        with self._lock:
+            self.workers[str(worker)] = _Worker(test, backend)
+            self.commits.setdefault(backend, 0)
+
+
+    def commit(self, worker: str | int, count: int = 1) -> None:
+        self.workers[str(worker)].commits += count
+
+
+    def test_finished(self, worker: str | int, status: str) -> None:
+        with self._lock:
+            current = self.workers.pop(str(worker), None)
+            if current is not None:
+                self.commits[current.backend] = self.commits.get(current.backend, 0) + current.commits
+                self.finished_seconds += time.monotonic() - current.started
+            self.finished[status] = self.finished.get(status, 0) + 1
+
+
+    @property
+    def done(self) -> int:
+        return sum(self.finished.values())
+
+
+    def eta(self) -> float | None:
+        """Seconds until the last test finishes, from the mean duration of finished tests"""
+        if not self.done:
+            return None
+        mean = self.finished_seconds / self.done
+        now = time.monotonic()
+        queued = max(0, self.total - self.done - len(self.workers))
+        remaining = queued * mean + sum(max(0.0, mean - (now - w.started)) for w in self.workers.values())
+        return remaining / max(1, len(self.workers))
+
+
+    def tick(self) -> None:
+        """Update the rates, then write the metrics file and the status line"""
+        with self._lock:
+            now = time.monotonic()
+            elapsed = max(now - self._last_tick, 1e-9)
+            totals = dict(self.commits)
+            for worker in self.workers.values():
+                totals[worker.backend] = totals.get(worker.backend, 0) + worker.commits
+                if worker.commits != worker.last_commits:
+                    worker.last_commits = worker.commits
+                    worker.last_progress = now
+            self.rates = {backend: (count - self._last_commits.get(backend, 0)) / elapsed
+                          for backend, count in totals.items()}
+            self._last_commits = totals
+            self._last_tick = now
+            text = self.openmetrics(totals, now)
+            line = self.status_line(now)
+
+        if self.metrics_path is not None:
+            self.metrics_path.parent.mkdir(parents=True, exist_ok=True)
+            temporary = self.metrics_path.with_name(self.metrics_path.name + '.tmp')
+            temporary.write_text(text)
+            os.replace(temporary, self.metrics_path)
+        if self.status:
+            self.stream.write(f'\r\033[K{line}' if self._tty else f'{line}\n')
+            self.stream.flush()
+
+
+    def _run(self) -> None:
+        while not self._stop.wait(self.interval):
+            self.tick()
+
+
+    def stalled(self, now: float) -> list[tuple[str, _Worker]]:
+        return [(name, w) for name, w in sorted(self.workers.items()) if now - w.last_progress >= self.stall_seconds]
+
+
+    def status_line(self, now: float) -> str:
+        passed = self.finished.get('pass', 0)
+        rate = f'{100 * passed / self.done:.0f}%' if self.done else '-'
+        throughput = ' '.join(f'{backend} {r:,.0f}/s' for backend, r in sorted(self.rates.items())) or '-'
+        eta = self.eta()
+        line = (f'[{_duration(now - self.started)}] {self.done}/{self.total} done, {passed} passed ({rate}), '
+                f'{len(self.workers)} running, {max(0, self.total - self.done - len(self.workers))} queued | '
+                f'{throughput} | ETA {_duration(eta) if eta is not None else "?"}')
+        stalled = self.stalled(now)
+        if stalled:
+            line += ' | stalled: ' + ', '.join(f'{w.test} ({_duration(now - w.last_progress)})' for _, w in stalled)
+        return line
+
+
+    def openmetrics(self, totals: dict[str, int], now: float) -> str:
+        """The current state in the OpenMetrics text format"""
+        lines = []
+
+        def family(name: str, kind: str, help_text: str, samples: list[tuple[str, dict, float]]) -> None:
+            lines.append(f'# TYPE {name} {kind}')
+            lines.append(f'# HELP {name} {help_text}')
+            for suffix, labels, value in samples:
+                label_text = ','.join(f'{k}="{_label(v)}"' for k, v in labels.items())
+                lines.append(f'{name}{suffix}{{{label_text}}} {value}' if labels else f'{name}{suffix} {value}')
+
+        family('friscv_tests_planned', 'gauge', 'Tests in this run.', [('', {}, self.total)])
+        family('friscv_tests', 'counter', 'Tests finished, by status.',
+               [('_total', {'status': status}, count) for status, count in sorted(self.finished.items())])
+        family('friscv_queue_depth', 'gauge', 'Tests not started yet.',
+               [('', {}, max(0, self.total - self.done - len(self.workers)))])
+        family('friscv_commits', 'counter', 'Instructions committed, by backend.',
+               [('_total', {'backend': b}, count) for b, count in sorted(totals.items())])
+        family('friscv_commits_per_second', 'gauge', 'Commit rate over the last interval, by backend.',
+               [('', {'backend': b}, round(r, 1)) for b, r in sorted(self.rates.items())])
+        workers = sorted(self.workers.items())
+        family('friscv_worker_test_seconds', 'gauge', 'Runtime of the test each worker is running.',
+               [('', {'worker': name, 'test': w.test, 'backend': w.backend}, round(now - w.started, 3))
+                for name, w in workers])
+        family('friscv_worker_test_commits', 'gauge', 'Commits of the test each worker is running.',
+               [('', {'worker': name, 'test': w.test, 'backend': w.backend}, w.commits) for name, w in workers])
+        family('friscv_worker_idle_seconds', 'gauge', 'Time since the worker last committed an instruction.',
+               [('', {'worker': name, 'test': w.test}, round(now - w.last_progress, 3)) for name, w in workers])
+        eta = self.eta()
+        if eta is not None:
+            family('friscv_eta_seconds', 'gauge', 'Estimated time to finish the run.', [('', {}, round(eta, 1))])
+        family('friscv_elapsed_seconds', 'gauge', 'Time since the run started.',
+               [('', {}, round(now - self.started, 3))])
+        lines.append('# EOF')
+        return '\n'.join(lines) + '\n'
+
+
+def commit_callback(tracker: ProgressTracker, worker: str | int, chained=None):
+    """An on_commit callback for run_test that counts commits, then calls chained"""
+    worker = str(worker)
+
+    def on_commit(index: int, state) -> None:
+        tracker.commit(worker)
+        if chained is not None:
+            chained(index, state)
+    return on_commit
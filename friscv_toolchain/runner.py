@@ -0,0 +1,162 @@
+import threading
+import time
+from pathlib import Path
+from typing import Callable
+
+from .checks import CheckReport, decode_checks, is_check_store
+from .state import State
+from .trace import TraceWriter
+
+
+TEST_RESULT_ADDR = 0x20000000
+TEST_PASSED = 0x1
+TEST_FAILED = 0x2
+
+
+class TestResult:
+    """
+    Outcome and cost of running one test on one simulator.
+    """
+    def __init__(self, name: str, elf_path: str) -> None:
+        self.name = name
+        self.elf_path = elf_path
+        self.status = 'error'
+        self.instret = 0
+        self.cycles: int | None = None
+        self.last_pc: int | None = None
+        self.phases: dict[str, float] = {}
+        self.message = ''
+        self.checks: CheckReport | None = None
+
+
+    @property
+    def cpi(self) -> float | None:
+        if self.cycles is None or not self.instret:
+            return None
+        return self.cycles / self.instret
+
+
+class ResultBuilder:
+    """
+    Folds a commit stream into a TestResult: budgets, cycles, the results
+    block and the TEST_RESULT write. Shared by the synchronous and the
+    asyncio runners.
+    """
+    def __init__(self, elf_path: str, max_cycles: int | None = None, timeout: float | None = None) -> None:
+        self.result = TestResult(Path(elf_path).stem, elf_path)
+        self.max_cycles = max_cycles
+        self.timeout = timeout
+        self.started_at = time.perf_counter()
+        self.deadline = self.started_at + timeout if timeout else None
+        self.first_cycle: int | None = None
+        self.last_cycle: int | None = None
+        self.check_words: dict[int, int] = {}
+
+
+    def out_of_budget(self, cancelled: bool = False) -> bool:
+        """Set the status and return True if the run must stop before the next commit"""
+        result = self.result
+        if self.max_cycles is not None and result.instret >= self.max_cycles:
+            result.status = 'timeout'
+            result.message = f'no result after {self.max_cycles} instructions'
+            return True
+        if cancelled:
+            result.status = 'cancelled'
+            result.message = f'cancelled after {result.instret} instructions'
+            return True
+        if self.deadline is not None and time.perf_counter() > self.deadline:
+            result.status = 'timeout'
+            result.message = f'no result after {self.timeout}s'
+            return True
+        return False
+
+
+    def stopped(self) -> None:
+        self.result.message = f'simulator stopped after {self.result.instret} instructions'
+
+
+    def add(self, state: State) -> bool:
+        """Account for one commit; returns True once the test wrote TEST_RESULT"""
+        result = self.result
+        result.last_pc = state.pc
+        if state.cycle is not None:
+            self.first_cycle = state.cycle if self.first_cycle is None else self.first_cycle
+            self.last_cycle = state.cycle
+        result.instret += 1
+
+        written = []
+        for addr, data in state.stores:
+            if addr == TEST_RESULT_ADDR:
+                written.append(data)
+            elif is_check_store(addr):
+                self.check_words[addr] = data
+        if written:
+            result.status = 'pass' if written[-1] == TEST_PASSED else 'fail'
+            result.message = f'TEST_RESULT = {written[-1]:#x}'
+            result.checks = decode_checks(self.check_words)
+            if result.checks is not None and result.checks.failures:
+                result.message += f', {result.checks}'
+            return True
+        return False
+
+
+    def failed(self, error: Exception) -> None:
+        self.result.status = 'error'
+        self.result.message = str(error)
+
+
+    def finish(self) -> TestResult:
+        if self.first_cycle is not None:
+            self.result.cycles = self.last_cycle - self.first_cycle + 1
+        self.result.phases['simulate'] = time.perf_counter() - self.started_at
+        return self.result
+
+
+def run_test(
+    sim,
+    max_cycles: int | None = None,
+    timeout: float | None = None,
+    trace: TraceWriter | None = None,
+    on_commit: Callable[[int, State], None] | None = None,
+    commit_timeout: float = 5,
+    started: bool = False,
+    cancel: threading.Event | None = None
+) -> TestResult:
+    """
+    Run a simulator until the test writes TEST_RESULT, the budget runs out or it stops.
+
+    Args:
+        sim: Started or unstarted simulator with start/next_commit/stop (e.g. SpikeInterface)
+        max_cycles: Maximum number of instructions to retire
+        timeout: Wall-clock budget in seconds
+        trace: Optional trace writer receiving every commit
+        on_commit: Optional callback(index, state) for every commit
+        commit_timeout: Seconds to wait for each commit
+        started: The simulator was already started (e.g. taken from a warm pool)
+        cancel: Stop early with status 'cancelled' once this event is set
+
+    Returns:
+        TestResult with status 'pass', 'fail', 'timeout', 'cancelled' or 'error'
+    """
+    builder = ResultBuilder(sim.elf_path, max_cycles, timeout)
+
+    try:
+        if not started:
+            sim.start()
+        while not builder.out_of_budget(cancel is not None and cancel.is_set()):
+            state = sim.next_commit(timeout=commit_timeout)
+            if state is None:
+                builder.stopped()
+                break
+            if trace:
+                trace.append(state)
+            if on_commit:
+                on_commit(builder.result.instret, state)
+            if builder.add(state):
+                break
+    except Exception as e:
+        builder.failed(e)
+    finally:
+        sim.stop()
+
+    return builder.finish()
@@ -0,0 +1,130 @@
+import argparse
+import json
+from pathlib import Path
+
+from .compiler import compile_riscv_tests
+from .fast_forward import FastForward
+from .manifest import discover_tests, select_tests
+from .runner import TEST_RESULT_ADDR, TEST_PASSED
+
+
+BUILD_SCRIPT_PATH = Path(__file__).parent.parent / 'build_scripts' / 'build-tests.sh'
+HELPERS = ('__mulsi3', '__udivsi3', '__umodsi3', '__divsi3', '__modsi3')
+DEFAULT_MAX_INSTS = 10_000_000
+
+
+class InstructionCount:
+    """
+    Retired instructions of one ELF run to completion on the fast-forward engine.
+    """
+    def __init__(self, total: int, helpers: dict[str, int], status: str) -> None:
+        self.total = total
+        self.helpers = helpers
+        self.status = status
+
+
+    @property
+    def helper_total(self) -> int:
+        return sum(self.helpers.values())
+
+
+def count_instructions(elf_path: Path | str, max_insts: int = DEFAULT_MAX_INSTS) -> InstructionCount:
+    """
+    Run an ELF until it halts and split its instruction count by helper routine.
+
+    Returns:
+        InstructionCount with status 'pass' or 'fail' from TEST_RESULT, or 'timeout'
+    """
+    engine = FastForward(str(elf_path))
+    block_counts: dict[int, int] = {}
+    engine.run(max_insts=max_insts, block_counts=block_counts)
+
+    helpers = dict.fromkeys(HELPERS, 0)
+    for pc, count in block_counts.items():
+        name = engine.image.symbol_at(pc)
+        if name in helpers:
+            helpers[name] += count
+
+    if not engine.halted:
+        status = 'timeout'
+    else:
+        status = 'pass' if engine.memory.load(TEST_RESULT_ADDR, 4) == TEST_PASSED else 'fail'
+    return InstructionCount(engine.instret, helpers, status)
+
+
+def runtime_savings(test_dir: Path, output_dir: Path, select: str | None = None,
+                    riscv_tools_path: str | None = None, max_insts: int = DEFAULT_MAX_INSTS) -> list[dict] | None:
+    """
+    Build the selected tests with libgcc and with runtime.S and compare their instruction counts.
+
+    Returns:
+        One row per test, or None if either build failed
+    """
+    tests, _ = select_tests(discover_tests(test_dir), select)
+    builds = {'libgcc': output_dir / 'libgcc', 'runtime': output_dir / 'runtime'}
+    for name, build_dir in builds.items():
+        if not compile_riscv_tests(BUILD_SCRIPT_PATH, test_dir, build_dir, riscv_tools_path,
+                                   tests=[test.source for test in tests], runtime=name == 'runtime'):
+            print(f'The {name} build failed')
+            return None
+
+    rows = []
+    for test in tests:
+        counts = {name: count_instructions(test.elf_path(build_dir), max_insts) for name, build_dir in builds.items()}
+        before, after = counts['libgcc'], counts['runtime']
+        rows.append({
+            'test': test.name,
+            'libgcc': before.total,
+            'runtime': after.total,
+            'saved': before.total - after.total,
+            'helpers_libgcc': before.helper_total,
+            'helpers_runtime': after.helper_total,
+            'status_libgcc': before.status,
+            'status_runtime': after.status,
+        })
+    return rows
+
+
+def format_report(rows: list[dict]) -> str:
+    lines = [f'{"test":24} {"libgcc":>10} {"runtime":>10} {"saved":>9} {"%":>6}   helpers (libgcc -> runtime)']
+    for row in rows:
+        percent = 100 * row['saved'] / row['libgcc'] if row['libgcc'] else 0
+        status = '' if row['status_libgcc'] == row['status_runtime'] == 'pass' else \
+            f'  [{row["status_libgcc"]} -> {row["status_runtime"]}]'
+        lines.append(f'{row["test"]:24} {row["libgcc"]:>10} {row["runtime"]:>10} {row["saved"]:>9} {percent:>5.1f}%   '
+                     f'{row["helpers_libgcc"]} -> {row["helpers_runtime"]}{status}')
+    before, after = sum(r['libgcc'] for r in rows), sum(r['runtime'] for r in rows)
+    if before:
+        lines.append(f'{"total":24} {before:>10} {after:>10} {before - after:>9} {100 * (before - after) / before:>5.1f}%')
+    return '\n'.join(lines)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description='Dynamic instruction savings of the runtime.S multiply/divide helpers over libgcc'
+    )
+    parser.add_argument('--test-dir', type=Path, default=Path('./test_sources/c'))
+    parser.add_argument('--output', type=Path, default=Path('./output/runtime-report'),
+                        help='Directory for the two builds')
+    parser.add_argument('--select', metavar='EXPR', help='Manifest selection expression')
+    parser.add_argument('--riscv-tools-path', help='Custom path to RISC-V toolchain')
+    parser.add_argument('--max-insts', type=int, default=DEFAULT_MAX_INSTS,
+                        help='Instruction budget per test')
+    parser.add_argument('--json', type=Path, help='Also write the rows as JSON')
+    args = parser.parse_args()
+
+    rows = runtime_savings(args.test_dir.resolve(), args.output.resolve(), args.select,
+                           args.riscv_tools_path, args.max_insts)
+    if rows is None:
+        raise SystemExit(1)
+    print(format_report(rows))
+    if args.json:
+        args.json.parent.mkdir(parents=True, exist_ok=True)
+        args.json.write_text(json.dumps(rows, indent=2))
+    if any(row['status_runtime'] != row['status_libgcc'] for row in rows):
+        print('Results differ between the builds')
+        raise SystemExit(1)
+
+
+if __name__ == '__main__':
+    main()
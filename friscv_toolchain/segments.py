@@ -0,0 +1,243 @@
+import functools
+import time
+from concurrent.futures import ProcessPoolExecutor, as_completed
+from pathlib import Path
+from typing import Callable
+
+from .checkpoint import Checkpoint, build_restore_elf, RESTORE_BASE, RESTORE_SPIKE_OPTS
+from .decoder import access_size
+from .elf import read_elf
+from .fast_forward import FastForward, Memory, PAGE_SHIFT, PAGE_SIZE
+from .spike_interface import SpikeInterface
+
+
+class Segment:
+    """
+    A slice of a long run between two golden-model checkpoints.
+    """
+    def __init__(self, index: int, start: Checkpoint, end: Checkpoint, restore_elf: Path) -> None:
+        self.index = index
+        self.start = start
+        self.end = end
+        self.restore_elf = restore_elf
+
+
+    @property
+    def length(self) -> int:
+        return self.end.instret - self.start.instret
+
+
+class SegmentResult:
+    def __init__(self, index: int, passed: bool, retired: int, mismatches: list[str], wall_time: float) -> None:
+        self.index = index
+        self.passed = passed
+        self.retired = retired
+        self.mismatches = mismatches
+        self.wall_time = wall_time
+
+
+def plan_segments(
+    elf_path: Path,
+    num_segments: int,
+    output_dir: Path,
+    riscv_tools_path: Path | str | None = None
+) -> list[Segment] | None:
+    """
+    Split a program run into equal-length segments at golden-model checkpoints.
+
+    Args:
+        elf_path: Program to split
+        num_segments: Number of segments (K)
+        output_dir: Directory for checkpoints and restore images
+        riscv_tools_path: Optional path to the RISC-V toolchain
+
+    Returns:
+        The segments in program order, or None if a restore image failed to build
+    """
+    engine = FastForward(str(elf_path))
+    total = engine.run()
+    print(f'Golden run of {elf_path.name}: {total} instructions ({engine.halt_reason})')
+
+    num_segments = max(1, min(num_segments, total))
+    bounds = [total * i // num_segments for i in range(num_segments + 1)]
+    engine = FastForward(str(elf_path))
+    checkpoints = []
+    for bound in bounds:
+        engine.run(max_insts=bound - engine.instret)
+        checkpoints.append(Checkpoint.from_fast_forward(engine))
+
+    segments = []
+    for i in range(num_segments):
+        restore_elf = build_restore_elf(checkpoints[i], elf_path, output_dir, riscv_tools_path)
+        if restore_elf is None:
+            print(f'Failed to build restore image for segment {i} of {elf_path.name}')
+            return None
+        segments.append(Segment(i, checkpoints[i], checkpoints[i + 1], restore_elf))
+    return segments
+
+
+def spike_factory(spike_path: str, elf_path: str) -> SpikeInterface:
+    """Start a Spike instance on a restore image"""
+    return SpikeInterface(
+        spike_path=spike_path,
+        isa='rv32i',
+        base_opts=RESTORE_SPIKE_OPTS,
+        start_pc=f'{RESTORE_BASE:#x}',
+        elf_path=elf_path
+    )
+
+
+def verify_segment(segment: Segment, sim_factory: Callable[[str], object], timeout: float = 5) -> SegmentResult:
+    """
+    Run one segment on its own simulator instance and check its end state.
+
+    The simulator boots the segment's restore image; commits of the restore
+    stub are skipped until the saved PC is reached. Register writes and
+    stores of the following segment.length commits are applied to the start
+    state and compared with the next checkpoint: every byte of every page in
+    it, so a store the simulator left out is caught too. A store to a RAM page
+    the golden run never wrote is a mismatch; stores outside RAM (MMIO) are
+    not checkpointed and not checked.
+
+    Args:
+        segment: Segment to verify
+        sim_factory: Callable creating a simulator (start/next_commit/stop) for an ELF path
+        timeout: Seconds to wait for each commit
+
+    Returns:
+        SegmentResult with the mismatches found
+    """
+    started = time.perf_counter()
+    regs = list(segment.start.regs)
+    written: dict[int, int] = {}
+    mismatches = []
+    retired = 0
+
+    sim = sim_factory(str(segment.restore_elf))
+    sim.start()
+    try:
+        state = sim.next_commit(timeout=timeout)
+        while state is not None and state.pc != segment.start.pc:
+            state = sim.next_commit(timeout=timeout)
+
+        while state is not None and retired < segment.length:
+            for reg, val in state.regs.items():
+                if reg:
+                    regs[reg] = val
+            size = access_size(state.inst) or 4
+            for addr, data in state.stores:
+                for i in range(size):
+                    written[addr + i] = (data >> (8 * i)) & 0xFF
+            retired += 1
+            state = sim.next_commit(timeout=timeout)
+
+        if retired < segment.length:
+            mismatches.append(f'simulator stopped after {retired} of {segment.length} instructions')
+        elif state is not None and state.pc != segment.end.pc:
+            mismatches.append(f'pc: expected {segment.end.pc:#010x}, got {state.pc:#010x}')
+    finally:
+        sim.stop()
+
+    for reg in range(1, 32):
+        if regs[reg] != segment.end.regs[reg]:
+            mismatches.append(f'x{reg}: expected {segment.end.regs[reg]:#010x}, got {regs[reg]:#010x}')
+
+    mismatches += _memory_mismatches(segment, written)
+
+    return SegmentResult(segment.index, not mismatches, retired, mismatches, time.perf_counter() - started)
+
+
+def _memory_mismatches(segment: Segment, written: dict[int, int]) -> list[str]:
+    """Compare the start pages with the simulator's byte writes applied against the end checkpoint"""
+    clean = Memory()
+    if segment.start.elf_path:
+        clean.load_image(read_elf(segment.start.elf_path))
+    ram_base, ram = clean.region(segment.start.pc)
+
+    by_page: dict[int, dict[int, int]] = {}
+    for addr, value in written.items():
+        by_page.setdefault(addr >> PAGE_SHIFT << PAGE_SHIFT, {})[addr] = value
+
+    mismatches = []
+    for page in sorted(by_page):
+        if page not in segment.end.pages and ram_base <= page < ram_base + len(ram):
+            first = min(by_page[page])
+            mismatches.append(f'mem[{first:#010x}]: store to a page the golden run never writes')
+
+    for page, expected in sorted(segment.end.pages.items()):
+        actual = segment.start.pages.get(page)
+        if actual is None:
+            actual = clean.read_page(page >> PAGE_SHIFT)
+        actual = bytearray(actual)
+        for addr, value in by_page.get(page, {}).items():
+            actual[addr - page] = value
+        if actual == expected:
+            continue
+        for offset in range(PAGE_SIZE):
+            if actual[offset] != expected[offset]:
+                mismatches.append(f'mem[{page + offset:#010x}]: expected {expected[offset]:#04x}, '
+                                  f'got {actual[offset]:#04x}')
+    return mismatches
+
+
+def verify_segments(
+    segments: list[Segment],
+    sim_factory: Callable[[str], object],
+    jobs: int | None = None,
+    timeout: float = 5
+) -> list[SegmentResult]:
+    """
+    Verify all segments in parallel, one simulator process per segment.
+
+    Args:
+        segments: Segments from plan_segments()
+        sim_factory: Picklable callable creating a simulator for an ELF path
+        jobs: Number of worker processes (default: one per segment)
+        timeout: Seconds to wait for each commit
+
+    Returns:
+        Results ordered by segment index
+    """
+    results = []
+    with ProcessPoolExecutor(max_workers=jobs or len(segments)) as pool:
+        futures = [pool.submit(verify_segment, segment, sim_factory, timeout) for segment in segments]
+        for future in as_completed(futures):
+            result = future.result()
+            status = 'PASS' if result.passed else 'FAIL'
+            print(f'Segment {result.index}: {status} ({result.retired} instructions, {result.wall_time:.2f}s)')
+            for mismatch in result.mismatches[:10]:
+                print(f'  {mismatch}')
+            results.append(result)
+    return sorted(results, key=lambda r: r.index)
+
+
+def run_segmented(
+    elf_path: Path,
+    num_segments: int,
+    output_dir: Path,
+    spike_path: str = 'spike',
+    jobs: int | None = None,
+    riscv_tools_path: Path | str | None = None
+) -> bool:
+    """
+    Split a long test into segments and verify them concurrently on Spike.
+
+    Returns:
+        True if every segment matched its end checkpoint
+    """
+    segments = plan_segments(elf_path, num_segments, output_dir, riscv_tools_path)
+    if segments is None:
+        return False
+
+    started = time.perf_counter()
+    results = verify_segments(segments, functools.partial(spike_factory, spike_path), jobs)
+    elapsed = time.perf_counter() - started
+    serial = sum(r.wall_time for r in results)
+
+    failed = [r.index for r in results if not r.passed]
+    print(f'{elf_path.name}: {len(results) - len(failed)}/{len(results)} segments passed in {elapsed:.2f}s '
+          f'(serial time {serial:.2f}s, speedup {serial / elapsed if elapsed else 0:.1f}x)')
+    if failed:
+        print(f'  First failing segment: {failed[0]} (instructions {segments[failed[0]].start.instret}'
+              f'-{segments[failed[0]].end.instret})')
+    return not failed
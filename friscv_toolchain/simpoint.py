@@ -0,0 +1,318 @@
+import argparse
+import functools
+import math
+import random
+from concurrent.futures import ProcessPoolExecutor
+from pathlib import Path
+from typing import Callable
+
+from .checkpoint import Checkpoint, build_restore_elf
+from .fast_forward import FastForward
+from .segments import spike_factory
+
+
+PROJECTED_DIMS = 15
+KMEANS_ITERATIONS = 100
+BIC_THRESHOLD = 0.9
+
+
+class SimPoint:
+    """
+    A cluster of similar intervals and the intervals sampled to represent it.
+    """
+    def __init__(self, cluster: int, weight: float, intervals: list[int]) -> None:
+        self.cluster = cluster
+        self.weight = weight
+        self.intervals = intervals
+        self.cpis: list[float] = []
+
+
+def collect_bbvs(elf_path: Path, interval: int) -> tuple[list[dict[int, int]], list[int]]:
+    """
+    Run the golden model and record a basic-block vector per fixed-length interval.
+
+    Args:
+        elf_path: Program to profile
+        interval: Interval length in instructions
+
+    Returns:
+        (BBVs as {block PC: instructions}, instruction count of each interval)
+    """
+    engine = FastForward(str(elf_path))
+    bbvs, lengths = [], []
+    while not engine.halted:
+        counts: dict[int, int] = {}
+        retired = engine.run(max_insts=interval, block_counts=counts)
+        if not retired:
+            break
+        bbvs.append(counts)
+        lengths.append(retired)
+    return bbvs, lengths
+
+
+def project(bbvs: list[dict[int, int]], dims: int = PROJECTED_DIMS, seed: int = 1) -> list[list[float]]:
+    """Normalise each BBV and reduce it to dims dimensions with a fixed random projection"""
+    columns: dict[int, list[float]] = {}
+    points = []
+    for bbv in bbvs:
+        total = sum(bbv.values()) or 1
+        point = [0.0] * dims
+        for pc, count in bbv.items():
+            column = columns.get(pc)
+            if column is None:
+                rng = random.Random(pc * 7919 + seed)
+                column = columns[pc] = [rng.uniform(-1, 1) for _ in range(dims)]
+            share = count / total
+            for d in range(dims):
+                point[d] += share * column[d]
+        points.append(point)
+    return points
+
+
+def _dist2(a: list[float], b: list[float]) -> float:
+    return sum((x - y) ** 2 for x, y in zip(a, b))
+
+
+def kmeans(points: list[list[float]], k: int, seed: int = 1) -> tuple[list[int], list[list[float]]]:
+    """k-means with k-means++ seeding; returns (cluster of each point, centroids)"""
+    rng = random.Random(seed)
+    centroids = [list(rng.choice(points))]
+    while len(centroids) < k:
+        weights = [min(_dist2(p, c) for c in centroids) for p in points]
+        if not sum(weights):
+            break
+        centroids.append(list(rng.choices(points, weights)[0]))
+
+    assign = None
+    for _ in range(KMEANS_ITERATIONS):
+        new_assign = [min(range(len(centroids)), key=lambda c: _dist2(p, centroids[c])) for p in points]
+        if new_assign == assign:
+            break
+        assign = new_assign
+        for c in range(len(centroids)):
+            members = [p for p, a in zip(points, assign) if a == c]
+            if members:
+                centroids[c] = [sum(col) / len(members) for col in zip(*members)]
+    return assign, centroids
+
+
+def _bic(points: list[list[float]], assign: list[int], centroids: list[list[float]]) -> float:
+    """Bayesian information criterion of a clustering (Pelleg and Moore, as used by SimPoint)"""
+    r, m, k = len(points), len(points[0]), len(centroids)
+    distortion = sum(_dist2(p, centroids[a]) for p, a in zip(points, assign))
+    variance = max(distortion / max(r - k, 1), 1e-12)
+    likelihood = 0.0
+    for c in range(k):
+        rn = assign.count(c)
+        if rn:
+            likelihood += (rn * math.log(rn) - rn * math.log(r) - rn / 2 * math.log(2 * math.pi)
+                           - rn * m / 2 * math.log(variance) - (rn - k) / 2)
+    return likelihood - k * (m + 1) / 2 * math.log(r)
+
+
+def choose_simpoints(
+    bbvs: list[dict[int, int]],
+    lengths: list[int],
+    max_k: int = 10,
+    samples_per_cluster: int = 2,
+    seed: int = 1
+) -> list[SimPoint]:
+    """
+    Cluster intervals and pick representative intervals with weights.
+
+    The smallest k whose BIC reaches 90% of the observed BIC range is used.
+    Each cluster is represented by the interval closest to its centroid,
+    plus randomly drawn members up to samples_per_cluster so the
+    within-cluster spread (and thus the estimate's error) can be measured.
+
+    Returns:
+        SimPoints with weights as fractions of all retired instructions
+    """
+    points = project(bbvs, seed=seed)
+    candidates = []
+    for k in range(1, min(max_k, len(points)) + 1):
+        assign, centroids = kmeans(points, k, seed)
+        candidates.append((_bic(points, assign, centroids), assign, centroids))
+    scores = [c[0] for c in candidates]
+    low, high = min(scores), max(scores)
+    _, assign, centroids = next(c for c in candidates if c[0] >= low + BIC_THRESHOLD * (high - low))
+
+    total = sum(lengths)
+    rng = random.Random(seed)
+    simpoints = []
+    for c, centroid in enumerate(centroids):
+        members = [i for i, a in enumerate(assign) if a == c]
+        if not members:
+            continue
+        members.sort(key=lambda i: _dist2(points[i], centroid))
+        chosen = [members[0]] + rng.sample(members[1:], min(samples_per_cluster - 1, len(members) - 1))
+        weight = sum(lengths[i] for i in members) / total
+        simpoints.append(SimPoint(c, weight, sorted(chosen)))
+    return simpoints
+
+
+def estimate_cpi(simpoints: list[SimPoint]) -> tuple[float, float | None]:
+    """
+    Combine per-interval CPIs into a whole-program estimate (stratified sampling).
+
+    Returns:
+        (estimated CPI, standard error), the error is None if no cluster had
+        more than one sample
+    """
+    estimate = sum(sp.weight * sum(sp.cpis) / len(sp.cpis) for sp in simpoints)
+
+    variances = {}
+    for sp in simpoints:
+        if len(sp.cpis) > 1:
+            mean = sum(sp.cpis) / len(sp.cpis)
+            variances[sp.cluster] = sum((c - mean) ** 2 for c in sp.cpis) / (len(sp.cpis) - 1)
+    if not variances:
+        return estimate, None
+    pooled = sum(variances.values()) / len(variances)
+    error = math.sqrt(sum(sp.weight ** 2 * variances.get(sp.cluster, pooled) / len(sp.cpis) for sp in simpoints))
+    return estimate, error
+
+
+def measure_interval(restore_elf: str, start: Checkpoint, warmup: int, length: int,
+                     sim_factory: Callable[[str], object], timeout: float = 5) -> float | None:
+    """
+    Run a restore image on the detailed simulator and return the CPI of the
+    interval that follows warmup instructions. Simulators that do not report
+    cycles (Spike) count one cycle per commit.
+    """
+    sim = sim_factory(restore_elf)
+    sim.start()
+    try:
+        state = sim.next_commit(timeout=timeout)
+        while state is not None and state.pc != start.pc:
+            state = sim.next_commit(timeout=timeout)
+
+        for _ in range(warmup):
+            if state is None:
+                return None
+            state = sim.next_commit(timeout=timeout)
+        if state is None:
+            return None
+
+        first_cycle = state.cycle
+        retired = 0
+        while state is not None and retired < length:
+            retired += 1
+            state = sim.next_commit(timeout=timeout)
+        if retired < length or state is None:
+            return None
+        if first_cycle is None or state.cycle is None:
+            return 1.0
+        return (state.cycle - first_cycle) / length
+    finally:
+        sim.stop()
+
+
+def run_simpoints(
+    elf_path: Path,
+    output_dir: Path,
+    interval: int,
+    sim_factory: Callable[[str], object],
+    max_k: int = 10,
+    samples_per_cluster: int = 2,
+    warmup: int = 0,
+    jobs: int | None = None,
+    riscv_tools_path: Path | str | None = None
+) -> tuple[list[SimPoint], float, float | None] | None:
+    """
+    Sampled simulation: pick SimPoints, simulate only them from checkpoints
+    and extrapolate whole-program CPI.
+
+    Returns:
+        (simpoints, estimated CPI, standard error), or None on failure
+    """
+    bbvs, lengths = collect_bbvs(elf_path, interval)
+    if not bbvs:
+        print(f'{elf_path.name} retired no instructions')
+        return None
+    simpoints = choose_simpoints(bbvs, lengths, max_k, samples_per_cluster)
+    sampled = sorted(i for sp in simpoints for i in sp.intervals)
+    print(f'{elf_path.name}: {len(bbvs)} intervals of {interval}, {len(simpoints)} clusters, '
+          f'simulating {len(sampled)} intervals ({sum(lengths[i] for i in sampled) / sum(lengths):.1%} of the run)')
+
+    engine = FastForward(str(elf_path))
+    starts = {}
+    for i in sampled:
+        engine.run(max_insts=max(0, i * interval - warmup) - engine.instret)
+        checkpoint = Checkpoint.from_fast_forward(engine)
+        restore_elf = build_restore_elf(checkpoint, elf_path, output_dir, riscv_tools_path)
+        if restore_elf is None:
+            return None
+        starts[i] = (str(restore_elf), checkpoint, i * interval - checkpoint.instret)
+
+    with ProcessPoolExecutor(max_workers=jobs) as pool:
+        futures = {i: pool.submit(measure_interval, elf, ckpt, skip, lengths[i], sim_factory)
+                   for i, (elf, ckpt, skip) in starts.items()}
+        cpis = {i: future.result() for i, future in futures.items()}
+
+    failed = [i for i, cpi in cpis.items() if cpi is None]
+    if failed:
+        print(f'Simulation of intervals {failed} did not complete')
+        return None
+    for sp in simpoints:
+        sp.cpis = [cpis[i] for i in sp.intervals]
+        print(f'  cluster {sp.cluster}: weight {sp.weight:.3f}, intervals {sp.intervals}, '
+              f'CPI {", ".join(f"{c:.3f}" for c in sp.cpis)}')
+
+    estimate, error = estimate_cpi(simpoints)
+    error_text = f' +/- {1.96 * error:.3f} (95% CI)' if error is not None else ' (no error estimate: one sample per cluster)'
+    print(f'{elf_path.name}: estimated CPI {estimate:.3f}{error_text}')
+    return simpoints, estimate, error
+
+
+def validate_simpoints(elf_path: Path, estimate: float, error: float | None,
+                       sim_factory: Callable[[str], object], output_dir: Path,
+                       riscv_tools_path: Path | str | None = None) -> float | None:
+    """
+    Simulate the whole program and report the relative error of the sampled estimate.
+
+    Returns:
+        Relative CPI error, or None if the full run failed
+    """
+    engine = FastForward(str(elf_path))
+    total = engine.run()
+    start = Checkpoint.from_fast_forward(FastForward(str(elf_path)))
+    restore_elf = build_restore_elf(start, elf_path, output_dir, riscv_tools_path)
+    if restore_elf is None:
+        return None
+    full_cpi = measure_interval(str(restore_elf), start, 0, total, sim_factory)
+    if full_cpi is None:
+        print(f'Full run of {elf_path.name} did not complete')
+        return None
+    relative = abs(estimate - full_cpi) / full_cpi
+    within = error is not None and abs(estimate - full_cpi) <= 1.96 * error
+    print(f'{elf_path.name}: full-run CPI {full_cpi:.3f}, sampled {estimate:.3f}, error {relative:.2%}'
+          + (' (within 95% CI)' if within else ''))
+    return relative
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description='SimPoint-style sampled CPI estimation')
+    parser.add_argument('elfs', nargs='+', type=Path, help='Compiled test ELF files')
+    parser.add_argument('--interval', type=int, default=10000, help='Interval length in instructions')
+    parser.add_argument('--max-k', type=int, default=10, help='Maximum number of clusters')
+    parser.add_argument('--samples', type=int, default=2, help='Intervals simulated per cluster')
+    parser.add_argument('--warmup', type=int, default=0, help='Warm-up instructions before each interval')
+    parser.add_argument('--jobs', '-j', type=int, help='Concurrent simulator processes')
+    parser.add_argument('--validate', action='store_true', help='Also simulate the full run and report the error')
+    parser.add_argument('--spike-path', default='spike', help='Spike executable')
+    parser.add_argument('--riscv-tools-path', help='Custom path to RISC-V toolchain')
+    parser.add_argument('--output', type=Path, default=Path('./output/simpoints'), help='Directory for checkpoints')
+    args = parser.parse_args()
+
+    sim_factory = functools.partial(spike_factory, args.spike_path)
+    for elf_path in args.elfs:
+        result = run_simpoints(elf_path, args.output, args.interval, sim_factory, args.max_k,
+                               args.samples, args.warmup, args.jobs, args.riscv_tools_path)
+        if result and args.validate:
+            _, estimate, error = result
+            validate_simpoints(elf_path, estimate, error, sim_factory, args.output, args.riscv_tools_path)
+
+
+if __name__ == '__main__':
+    main()
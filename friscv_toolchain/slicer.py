@@ -0,0 +1,110 @@
+import argparse
+import time
+from pathlib import Path
+
+from .decoder import decode
+from .listing import find_listing, load_listing
+from .trace import TraceReader, TraceRecord
+from .trace_index import TraceIndex, format_record, parse_reg
+
+
+def source_regs(inst: int) -> tuple[int, ...]:
+    """Registers an instruction reads as data (not counting the load/store address base or jalr target)"""
+    decoded = decode(inst)
+    if decoded is None:
+        return ()
+    if decoded.fmt in ('R', 'B'):
+        return tuple(r for r in (decoded.rs1, decoded.rs2) if r)
+    if decoded.fmt in ('I', 'SH'):
+        return (decoded.rs1,) if decoded.rs1 else ()
+    if decoded.fmt == 'S':
+        return (decoded.rs2,) if decoded.rs2 else ()
+    return ()
+
+
+def address_reg(inst: int) -> int | None:
+    """Base register of a load or store address"""
+    decoded = decode(inst)
+    if decoded is not None and decoded.fmt in ('L', 'S'):
+        return decoded.rs1 or None
+    return None
+
+
+def backward_slice(index: TraceIndex, position: int, reg: int | None = None, addr: int | None = None,
+                   size: int = 4, with_address: bool = False) -> list[TraceRecord]:
+    """
+    Collect the commits whose results flowed into a register or memory value.
+
+    Args:
+        index: On-disk index of the trace
+        position: Commit index at which the value is observed (inclusive)
+        reg: Register whose value to explain
+        addr: Memory address whose value to explain (with size bytes)
+        size: Access size for addr
+        with_address: Also follow the base registers of load and store addresses
+
+    Returns:
+        Contributing commits in program order
+    """
+    reader = index.reader
+    pending = []
+    if reg is not None:
+        pending.append(index.last_reg_write(reg, position + 1))
+    if addr is not None:
+        pending += [index.last_mem_write(byte, position + 1) for byte in range(addr, addr + size)]
+
+    seen = set()
+    while pending:
+        pos = pending.pop()
+        if pos is None or pos in seen:
+            continue
+        seen.add(pos)
+        record = reader.record(pos)
+        regs = list(source_regs(record.inst))
+        base = address_reg(record.inst)
+        if with_address and base is not None:
+            regs.append(base)
+        pending += [index.last_reg_write(r, pos) for r in regs]
+        if record.is_load:
+            pending += [index.last_mem_write(byte, pos) for byte in range(record.addr, record.addr + record.size)]
+
+    return [reader.record(pos) for pos in sorted(seen)]
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description='Backward dependency slice of a stored trace')
+    parser.add_argument('trace', type=Path, help='Trace file written with --dump-state')
+    parser.add_argument('--index', type=int, help='Commit index where the value is observed (default: last)')
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument('--reg', type=parse_reg, help='Register to explain (e.g. x5)')
+    target.add_argument('--addr', type=lambda x: int(x, 0), help='Memory address to explain')
+    parser.add_argument('--size', type=int, default=4, choices=[1, 2, 4], help='Access size for --addr')
+    parser.add_argument('--with-address', action='store_true', help='Include address computations')
+    parser.add_argument('--lst', type=Path, help='Disassembly listing for annotations (default: from output tree)')
+    args = parser.parse_args()
+
+    reader = TraceReader(args.trace)
+    position = len(reader) - 1 if args.index is None else args.index
+    if not 0 <= position < len(reader):
+        parser.error(f'Commit index {position} is outside the trace (0-{len(reader) - 1})')
+
+    lst_path = args.lst or find_listing(args.trace)
+    listing = load_listing(lst_path) if lst_path else None
+
+    started = time.perf_counter()
+    index = TraceIndex(reader)
+    indexed = time.perf_counter()
+    if index.built:
+        print(f'Indexed {len(reader)} commits into {index.path} in {indexed - started:.2f}s')
+    records = backward_slice(index, position, args.reg, args.addr, args.size, args.with_address)
+    done = time.perf_counter()
+
+    what = f'x{args.reg}' if args.reg is not None else f'mem[{args.addr:#x}]'
+    print(f'Slice of {what} at commit {position}: {len(records)} instructions '
+          f'(slice {(done - indexed) * 1000:.1f} ms)')
+    for record in records:
+        print(format_record(record, listing))
+
+
+if __name__ == '__main__':
+    main()
@@ -4,44 +4,104 @@ import shutil
 import subprocess
 import re
 import threading
-import time
 
+from .line_buffer import DEFAULT_BUFFER_BYTES, LineBuffer, format_stats
 from .state import State
 
 
-class SpikeInterface:
+# Memory map and entry point of the test programs: 64K of RAM at the reset
+# vector and the page holding TEST_RESULT
+SPIKE_OPTS = '-m0x80000000:0x10000,0x20000000:0x1000'
+START_PC = '0x80000000'
+
+class CommitParser:
     """
-    Interface to run Spike in debug mode and parse commit-level state.
+    Turns Spike --log-commits output into States, one line at a time.
+
+    Register and store lines follow their commit line and may arrive later,
+    so a commit is complete only once the line of the one after it is read.
+    The parser therefore always keeps one commit in flight.
+
+    Only integers are kept: the disassembly Spike prints after the
+    instruction word is skipped (and may be absent), since State.disasm
+    decodes it from inst for the few commits that get printed.
     """
-    COMMIT_RE = re.compile(r"core\s+(?P<core>\d+):\s+(?P<pc>0x[0-9a-fA-F]+)\s+\((?P<inst>0x[0-9a-fA-F]+)\)\s+(?P<disasm>.+)")
+    COMMIT_RE = re.compile(r"core\s+(?P<core>\d+):\s+(?P<pc>0x[0-9a-fA-F]+)\s+\((?P<inst>0x[0-9a-fA-F]+)\)")
     REG_RE    = re.compile(r"\s*x(?P<reg>\d+)\s+=\s+(?P<val>0x[0-9a-fA-F]+)")
     MEM_RE    = re.compile(r"store:\s+addr=(?P<addr>0x[0-9a-fA-F]+)\s+data=(?P<data>0x[0-9a-fA-F]+)")
 
 
-    def __init__(self, spike_path: str, isa: str, base_opts: str, start_pc: str, elf_path: str) -> None:
+    def __init__(self) -> None:
+        self.pending: State | None = None
+
+
+    def feed(self, line: str) -> State | None:
+        """Parse one stdout line; returns the previous commit once this line starts a new one"""
+        m = self.COMMIT_RE.match(line)
+        if m:
+            state = State(int(m.group('core')), int(m.group('pc'), 16), int(m.group('inst'), 16))
+            previous, self.pending = self.pending, state
+            return previous
+
+        if self.pending is None:
+            return None
+
+        mr = self.REG_RE.match(line)
+        if mr:
+            self.pending.regs[int(mr.group('reg'))] = int(mr.group('val'), 16)
+            return None
+
+        mm = self.MEM_RE.search(line)
+        if mm:
+            self.pending.stores.append((int(mm.group('addr'), 16), int(mm.group('data'), 16)))
+        return None
+
+
+def spike_command(spike_path: str, isa: str, base_opts: str, start_pc: str, elf_path: str) -> list[str]:
+    """Command line for Spike in debug mode with commit logging"""
+    return [
+        spike_path,
+        '-d',
+        f'--isa={isa}',
+        *base_opts.split(),
+        f'--pc={start_pc}',
+        '--log-commits',
+        elf_path
+    ]
+
+
+class SpikeInterface:
+    """
+    Interface to run Spike in debug mode and parse commit-level state.
+    """
+
+    def __init__(self, spike_path: str, isa: str, base_opts: str, start_pc: str, elf_path: str,
+                 verbose: bool = True, cpu: int | None = None, buffer_bytes: int = DEFAULT_BUFFER_BYTES) -> None:
         self.spike_path = spike_path
         self.isa = isa
         self.base_opts = base_opts
         self.start_pc = start_pc
         self.elf_path = elf_path
+        self.verbose = verbose
+        # Pin the Spike process to this CPU; rusage holds its resource usage once stopped
+        self.cpu = cpu
+        self.rusage = None
         self.proc = None
-        self._queue = queue.Queue()
+        # Unread output per pipe; a full buffer stops its reader and so stalls Spike
+        self.buffer_bytes = buffer_bytes
+        self._buffer = LineBuffer(buffer_bytes)
+        self._parser = CommitParser()
         self._thread_stdout = None
         self._thread_stderr = None
 
 
     def start(self) -> None:
-        cmd = [
-            self.spike_path,
-            '-d',
-            f'--isa={self.isa}',
-            *self.base_opts.split(),
-            f'--pc={self.start_pc}',
-            '--log-commits',
-            self.elf_path
-        ]
-
-        print(f'Starting Spike with command {" ".join(cmd)}')
+        cmd = spike_command(self.spike_path, self.isa, self.base_opts, self.start_pc, self.elf_path)
+
+        if self.verbose:
+            print(f'Starting Spike with command {" ".join(cmd)}')
+        self._parser = CommitParser()
+        self._buffer = LineBuffer(self.buffer_bytes)
 
         self.proc = subprocess.Popen(
             cmd,
@@ -51,96 +111,105 @@ class SpikeInterface:
             text=True,
             bufsize=1
         )
+        self.rusage = None
+        if self.cpu is not None:
+            # Set from here rather than in a preexec_fn, which is unsafe with the reader threads
+            os.sched_setaffinity(self.proc.pid, {self.cpu})
 
-        self._thread_stdout = threading.Thread(target=self._enqueue_stdout, daemon=True)
-        self._thread_stderr = threading.Thread(target=self._enqueue_stderr, daemon=True)
+        self._thread_stdout = threading.Thread(target=self._enqueue, args=(self.proc.stdout, 'stdout'), daemon=True)
+        self._thread_stderr = threading.Thread(target=self._enqueue, args=(self.proc.stderr, 'stderr'), daemon=True)
         self._thread_stdout.start()
         self._thread_stderr.start()
 
-        time.sleep(0.1)
+        # No need to wait for Spike to come up: the command waits in the pipe until it reads its prompt
         self._send_command('run 1')
 
 
     def _send_command(self, cmd: str) -> None:
         """Send a command to the Spike process"""
         if self.proc and self.proc.stdin:
-            print(f"Sending command: {cmd}")
+            if self.verbose:
+                print(f"Sending command: {cmd}")
             self.proc.stdin.write(f"{cmd}\n")
             self.proc.stdin.flush()
 
 
-    def _enqueue_stdout(self) -> None:
-        """Capture stdout output"""
-        if not self.proc or not self.proc.stdout:
-            return
-        
-        for line in self.proc.stdout:
+    def _enqueue(self, pipe, source: str) -> None:
+        """Capture one pipe's output, waiting whenever its buffer is full"""
+        buffer = self._buffer
+        for line in pipe:
             line = line.strip()
             if line:
-                print(f"STDOUT: {line}")
-                self._queue.put(('stdout', line))
-
-
-    def _enqueue_stderr(self) -> None:
-        """Capture stderr output"""
-        if not self.proc or not self.proc.stderr:
-            return
-        
-        for line in self.proc.stderr:
-            line = line.strip()
-            if line:
-                print(f"STDERR: {line}")
-                self._queue.put(('stderr', line))
+                if self.verbose:
+                    print(f"{source.upper()}: {line}")
+                if not buffer.put((source, line)):
+                    return
 
 
     def next_commit(self, timeout=None) -> State | None:
-        state = State()
+        """
+        Return the next committed instruction with its register writes and stores.
 
+        The parser keeps one commit in flight (see CommitParser), so this asks
+        Spike for one more commit than it returns.
+        """
         if self.proc and self.proc.stdin:
             self.proc.stdin.write('run 1\n')
             self.proc.stdin.flush()
 
         while True:
             try:
-                line = self._queue.get(timeout=timeout)
+                _, line = self._buffer.get(timeout=timeout)
             except queue.Empty:
                 return None
-            
-            m = self.COMMIT_RE.match(line)
-            if m:
-                state.core   = int(m.group('core'))
-                state.pc     = m.group('pc')
-                state.inst   = m.group('inst')
-                state.disasm = m.group('disasm')
-                break
-
-        while True:
-            try:
-                line = self._queue.get_nowait()
-            except queue.Empty:
-                break
-
-            mr = self.REG_RE.match(line)
-            if mr:
-                reg = int(mr.group('reg'))
-                val = mr.group('val')
-                state.regs[reg] = val
-                continue
+            state = self._parser.feed(line)
+            if state is not None:
+                return state
 
-            mm = self.MEM_RE.search(line)
-            if mm:
-                addr = mm.group('addr')
-                data = mm.group('data')
-                state.stores.append((addr, data))
 
-        return state
+    def buffer_stats(self) -> dict:
+        """Buffered lines and blocked time of the current or last run (see LineBuffer)"""
+        return self._buffer.stats()
 
 
     def stop(self):
         if self.proc:
             self.proc.terminate()
-            self.proc.wait()
+            self._buffer.close()
+            self._reap()
             self.proc = None
+            if self.verbose:
+                print(f'Spike output buffers: {format_stats(self.buffer_stats())}')
+
+
+    def _reap(self) -> None:
+        """Wait for the process with wait4 to keep its user/sys time and context switches"""
+        try:
+            _, status, self.rusage = os.wait4(self.proc.pid, 0)
+            self.proc.returncode = os.waitstatus_to_exitcode(status)
+        except ChildProcessError:
+            self.proc.wait()
+
+
+def find_spike(custom_path: str | None = None) -> str | None:
+    """
+    Resolve the Spike executable.
+
+    Args:
+        custom_path: Optional Spike executable, or installation directory containing spike or bin/spike
+
+    Returns:
+        Path of the executable, or None if it was not found
+    """
+    if not custom_path:
+        return shutil.which('spike')
+
+    for candidate in (custom_path, os.path.join(custom_path, 'spike'), os.path.join(custom_path, 'bin', 'spike')):
+        if os.path.isfile(candidate) and os.access(candidate, os.X_OK):
+            return candidate
+
+    print(f"Warning: Custom Spike path {custom_path} is invalid.")
+    return None
 
 
 def get_spike_installed(custom_path: str | None = None) -> bool:
@@ -153,20 +222,7 @@ def get_spike_installed(custom_path: str | None = None) -> bool:
     Returns:
         True if Spike is installed and working, False otherwise
     """
-    if custom_path:
-        possible_cmd_path = os.path.join(custom_path, 'spike')
-        if os.path.exists(possible_cmd_path) and os.access(possible_cmd_path, os.X_OK):
-            spike_cmd = possible_cmd_path
-        else:
-            possible_cmd_path = os.path.join(custom_path, 'bin', 'spike')
-            if os.path.exists(possible_cmd_path) and os.access(possible_cmd_path, os.X_OK):
-                spike_cmd = possible_cmd_path
-            else:
-                print(f"Warning: Custom Spike path {custom_path} is invalid.")
-                return False
-    else:
-        spike_cmd = shutil.which('spike')
-
+    spike_cmd = find_spike(custom_path)
     if not spike_cmd:
         return False
 
@@ -177,5 +233,5 @@ def get_spike_installed(custom_path: str | None = None) -> bool:
         print(f'Error executing Spike: {e}')
         return False
     except FileNotFoundError:
-        print(f'Error: Spike executable not found at {spike_cmd if spike_cmd else 'PATH'}')
-        return False
+        print(f'Error: Spike executable not found at {spike_cmd}')
+        return False
\ No newline at end of file
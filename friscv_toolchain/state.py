@@ -1,16 +1,38 @@
+from .decoder import disassemble
+
+
 class State:
+    """
+    One committed instruction. PC, instruction word, register values and
+    store addresses and data are integers; the disassembly is produced from
+    inst only when it is read.
+    """
     def __init__(
             self,
             core: int | None = None,
-            pc: str | None = None,
-            inst: str | None = None,
+            pc: int | None = None,
+            inst: int | None = None,
             disasm: str | None = None,
-            regs: dict[int, str] = {},
-            stores: list[tuple[str, str]] = []
+            regs: dict[int, int] | None = None,
+            stores: list[tuple[int, int]] | None = None,
+            cycle: int | None = None
         ) -> None:
         self.core = core
         self.pc = pc
         self.inst = inst
-        self.disasm = disasm
-        self.regs = regs
-        self.stores = stores
\ No newline at end of file
+        self._disasm = disasm
+        self.regs = regs if regs is not None else {}
+        self.stores = stores if stores is not None else []
+        self.cycle = cycle
+
+
+    @property
+    def disasm(self) -> str | None:
+        if self._disasm is None and self.inst is not None:
+            self._disasm = disassemble(self.inst)
+        return self._disasm
+
+
+    @disasm.setter
+    def disasm(self, text: str | None) -> None:
+        self._disasm = text
\ No newline at end of file
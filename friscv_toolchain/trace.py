@@ -0,0 +1,115 @@
+import mmap
+import struct
+from pathlib import Path
+
+from .decoder import access_size, decode
+from .state import State
+
+
+TRACE_MAGIC = b'FRVTRC01'
+HEADER = struct.Struct('<8sII')
+RECORD = struct.Struct('<IIIIII')
+RECORD_WORDS = RECORD.size // 4
+
+# meta word: bits 0-4 rd, bit 8 rd written, bit 9 load, bit 10 store, bits 12-14 access size
+META_RD_WRITE = 1 << 8
+META_LOAD = 1 << 9
+META_STORE = 1 << 10
+
+
+class TraceRecord:
+    """
+    One committed instruction as stored in a trace file.
+    """
+    __slots__ = ('index', 'pc', 'inst', 'rd', 'rd_val', 'is_load', 'is_store', 'size', 'addr', 'data')
+
+    def __init__(self, index: int, pc: int, inst: int, rd_val: int, addr: int, data: int, meta: int) -> None:
+        self.index = index
+        self.pc = pc
+        self.inst = inst
+        self.rd = meta & 0x1F if meta & META_RD_WRITE else None
+        self.rd_val = rd_val
+        self.is_load = bool(meta & META_LOAD)
+        self.is_store = bool(meta & META_STORE)
+        self.size = (meta >> 12) & 0x7
+        self.addr = addr
+        self.data = data
+
+
+class TraceWriter:
+    """
+    Write a commit stream to a fixed-size binary record file.
+
+    Load addresses are not in Spike's commit output, so the writer tracks
+    register values from the stream and computes them from the decoded
+    instruction.
+    """
+    def __init__(self, path: Path | str, regs: list[int] | None = None) -> None:
+        self.path = Path(path)
+        self.path.parent.mkdir(parents=True, exist_ok=True)
+        self._file = open(self.path, 'wb')
+        self._file.write(HEADER.pack(TRACE_MAGIC, RECORD.size, 0))
+        self._regs = list(regs) if regs is not None else [0] * 32
+        self.count = 0
+
+
+    def append(self, state: State) -> None:
+        pc = state.pc
+        inst = state.inst
+        decoded = decode(inst)
+        meta = addr = data = rd_val = 0
+
+        if decoded and decoded.fmt == 'L':
+            addr = (self._regs[decoded.rs1] + decoded.imm) & 0xFFFFFFFF
+            meta |= META_LOAD | (access_size(inst) << 12)
+        if state.stores:
+            addr, data = state.stores[0]
+            meta |= META_STORE | ((access_size(inst) or 4) << 12)
+        for reg, val in state.regs.items():
+            if reg:
+                rd_val = val
+                self._regs[reg] = rd_val
+                meta |= META_RD_WRITE | reg
+
+        self._file.write(RECORD.pack(pc, inst, rd_val, addr, data, meta))
+        self.count += 1
+
+
+    def close(self) -> None:
+        if self._file:
+            self._file.close()
+            self._file = None
+
+
+    def __enter__(self) -> 'TraceWriter':
+        return self
+
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+
+class TraceReader:
+    """
+    Random access to a trace file through a memory map.
+    """
+    def __init__(self, path: Path | str) -> None:
+        self.path = Path(path)
+        with open(self.path, 'rb') as f:
+            magic, record_size, _ = HEADER.unpack(f.read(HEADER.size))
+            if magic != TRACE_MAGIC or record_size != RECORD.size:
+                raise ValueError(f'{path} is not a FRISC-V trace file')
+            size = f.seek(0, 2)
+            self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) if size > HEADER.size else None
+        self.count = (size - HEADER.size) // RECORD.size
+        self.words = memoryview(self._map)[HEADER.size:HEADER.size + self.count * RECORD.size].cast('I') \
+            if self._map else memoryview(b'').cast('I')
+
+
+    def __len__(self) -> int:
+        return self.count
+
+
+    def record(self, index: int) -> TraceRecord:
+        base = index * RECORD_WORDS
+        return TraceRecord(index, *self.words[base:base + RECORD_WORDS])
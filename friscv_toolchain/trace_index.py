@@ -0,0 +1,315 @@
+import argparse
+import bisect
+import hashlib
+import mmap
+import struct
+import time
+from array import array
+from pathlib import Path
+
+from .decoder import disassemble
+from .elf import read_elf
+from .listing import Listing, find_listing, load_listing
+from .trace import TraceReader, TraceRecord, RECORD_WORDS, META_RD_WRITE, META_STORE
+
+
+INDEX_MAGIC = b'FRVIDX02'
+# magic, trace record count, trace mtime (ns), hash of the trace's first and last
+# FINGERPRINT_BYTES, then one (keys, positions) count pair per section
+INDEX_HEADER = struct.Struct('<8sQQ8s')
+SECTION_HEADER = struct.Struct('<II')
+SECTIONS = ('reg', 'store', 'pc')
+FINGERPRINT_BYTES = 64 * 1024
+
+CHUNK_RECORDS = 1 << 20
+
+
+def index_path(trace_path: Path | str) -> Path:
+    return Path(f'{trace_path}.idx')
+
+
+class Postings:
+    """
+    Sorted commit positions per key: keys[i] owns positions[offsets[i]:offsets[i + 1]].
+    """
+    def __init__(self, keys, offsets, positions) -> None:
+        self.keys = keys
+        self.offsets = offsets
+        self.positions = positions
+
+
+    def get(self, key: int):
+        """Positions of a key (a memoryview slice), empty if the key never occurs"""
+        i = bisect.bisect_left(self.keys, key)
+        if i == len(self.keys) or self.keys[i] != key:
+            return self.positions[0:0]
+        return self.positions[self.offsets[i]:self.offsets[i + 1]]
+
+
+    def last_before(self, key: int, before: int) -> int | None:
+        positions = self.get(key)
+        i = bisect.bisect_left(positions, before) - 1
+        return positions[i] if i >= 0 else None
+
+
+def trace_fingerprint(path: Path) -> tuple[int, bytes]:
+    """
+    Modification time and a hash of the head and tail of a trace, so that a
+    re-recorded trace of the same length does not reuse a stale index.
+    """
+    digest = hashlib.blake2b(digest_size=8)
+    with open(path, 'rb') as f:
+        size = f.seek(0, 2)
+        f.seek(0)
+        digest.update(f.read(FINGERPRINT_BYTES))
+        if size > FINGERPRINT_BYTES:
+            f.seek(max(FINGERPRINT_BYTES, size - FINGERPRINT_BYTES))
+            digest.update(f.read())
+    return path.stat().st_mtime_ns, digest.digest()
+
+
+def _collect(reader: TraceReader) -> dict[str, dict[int, array]]:
+    """One pass over the trace, chunk by chunk, gathering positions per key"""
+    postings = {name: {} for name in SECTIONS}
+    regs, stores, pcs = postings['reg'], postings['store'], postings['pc']
+    words = reader.words
+
+    for base in range(0, len(reader), CHUNK_RECORDS):
+        end = min(base + CHUNK_RECORDS, len(reader))
+        chunk = words[base * RECORD_WORDS:end * RECORD_WORDS]
+        for i, pc in enumerate(chunk[0::RECORD_WORDS].tolist(), base):
+            positions = pcs.get(pc)
+            if positions is None:
+                positions = pcs[pc] = array('I')
+            positions.append(i)
+        metas = chunk[5::RECORD_WORDS].tolist()
+        addrs = chunk[3::RECORD_WORDS].tolist()
+        for offset, meta in enumerate(metas):
+            if meta & META_RD_WRITE:
+                regs.setdefault(meta & 0x1F, array('I')).append(base + offset)
+            if meta & META_STORE:
+                # Stores are keyed by word; a store never crosses a word boundary in RV32I test code
+                stores.setdefault(addrs[offset] & ~0x3, array('I')).append(base + offset)
+    return postings
+
+
+def build_index(reader: TraceReader, path: Path | str | None = None) -> Path:
+    """
+    Write the register, store-address and PC postings of a trace next to it.
+
+    Args:
+        reader: Open trace
+        path: Index file (default: <trace>.idx)
+
+    Returns:
+        Path of the index file
+    """
+    path = Path(path) if path else index_path(reader.path)
+    postings = _collect(reader)
+    tmp = path.with_suffix(path.suffix + '.tmp')
+    with open(tmp, 'wb') as f:
+        f.write(INDEX_HEADER.pack(INDEX_MAGIC, len(reader), *trace_fingerprint(reader.path)))
+        for name in SECTIONS:
+            table = postings[name]
+            keys = array('I', sorted(table))
+            offsets = array('I', [0])
+            for key in keys:
+                offsets.append(offsets[-1] + len(table[key]))
+            f.write(SECTION_HEADER.pack(len(keys), offsets[-1]))
+            keys.tofile(f)
+            offsets.tofile(f)
+            for key in keys:
+                table[key].tofile(f)
+    tmp.replace(path)
+    return path
+
+
+class TraceIndex:
+    """
+    Memory-mapped secondary indexes of a trace, built on first use.
+    """
+    def __init__(self, reader: TraceReader, path: Path | str | None = None, rebuild: bool = False) -> None:
+        self.reader = reader
+        self.path = Path(path) if path else index_path(reader.path)
+        self.built = False
+        if rebuild or not self._is_current():
+            build_index(reader, self.path)
+            self.built = True
+
+        with open(self.path, 'rb') as f:
+            self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        view = memoryview(self._map)
+        offset = INDEX_HEADER.size
+        sections = {}
+        for name in SECTIONS:
+            num_keys, num_positions = SECTION_HEADER.unpack_from(self._map, offset)
+            offset += SECTION_HEADER.size
+            keys = view[offset:offset + 4 * num_keys].cast('I')
+            offset += 4 * num_keys
+            offsets = view[offset:offset + 4 * (num_keys + 1)].cast('I')
+            offset += 4 * (num_keys + 1)
+            positions = view[offset:offset + 4 * num_positions].cast('I')
+            offset += 4 * num_positions
+            sections[name] = Postings(keys, offsets, positions)
+        self.regs = sections['reg']
+        self.stores = sections['store']
+        self.pcs = sections['pc']
+
+
+    def _is_current(self) -> bool:
+        if not self.path.is_file():
+            return False
+        with open(self.path, 'rb') as f:
+            header = f.read(INDEX_HEADER.size)
+        if len(header) != INDEX_HEADER.size:
+            return False
+        magic, count, mtime, digest = INDEX_HEADER.unpack(header)
+        return (magic == INDEX_MAGIC and count == len(self.reader)
+                and (mtime, digest) == trace_fingerprint(self.reader.path))
+
+
+    def last_reg_write(self, reg: int, before: int) -> int | None:
+        """Position of the last write to reg strictly before position before"""
+        return self.regs.last_before(reg, before)
+
+
+    def last_mem_write(self, addr: int, before: int) -> int | None:
+        """Position of the last store covering byte addr strictly before position before"""
+        positions = self.stores.get(addr & ~0x3)
+        i = bisect.bisect_left(positions, before) - 1
+        words = self.reader.words
+        while i >= 0:
+            base = positions[i] * RECORD_WORDS
+            start, size = words[base + 3], (words[base + 5] >> 12) & 0x7
+            if start <= addr < start + size:
+                return positions[i]
+            i -= 1
+        return None
+
+
+    def stores_to(self, addr: int, size: int = 1) -> list[int]:
+        """Positions of all stores overlapping [addr, addr + size)"""
+        found = set()
+        words = self.reader.words
+        for word in range(addr & ~0x3, addr + size, 4):
+            for pos in self.stores.get(word):
+                base = pos * RECORD_WORDS
+                start, length = words[base + 3], (words[base + 5] >> 12) & 0x7
+                if start < addr + size and addr < start + length:
+                    found.add(pos)
+        return sorted(found)
+
+
+    def pc_hits(self, pc: int):
+        """Sorted positions of every commit at pc"""
+        return self.pcs.get(pc)
+
+
+def format_record(record: TraceRecord, listing: Listing | None = None) -> str:
+    line = f'#{record.index:<10} {record.pc:#010x}  ({record.inst:#010x})'
+    if listing is not None:
+        line += f'  {listing.annotate(record.pc)}'.ljust(56)
+    else:
+        line += f'  {disassemble(record.inst)}'.ljust(32)
+    if record.rd is not None:
+        line += f'  x{record.rd}={record.rd_val:#010x}'
+    if record.is_load:
+        line += f'  load [{record.addr:#010x}]'
+    if record.is_store:
+        line += f'  store [{record.addr:#010x}]={record.data:#x}'
+    return line
+
+
+def parse_reg(name: str) -> int:
+    name = name.strip().lower()
+    if name.startswith('x') and name[1:].isdigit() and int(name[1:]) < 32:
+        return int(name[1:])
+    raise argparse.ArgumentTypeError(f'Invalid register: {name}')
+
+
+def resolve_pc(text: str, trace_path: Path, elf_path: Path | None = None) -> int:
+    """Turn an address or a function name into a PC, using the ELF symbols or the listing"""
+    try:
+        return int(text, 0)
+    except ValueError:
+        pass
+    if elf_path:
+        symbol = read_elf(str(elf_path)).symbols.get(text)
+        if symbol:
+            return symbol[0]
+    lst_path = find_listing(trace_path)
+    if lst_path:
+        starts = [start for function, start, _ in load_listing(lst_path).entries.values() if function == text]
+        if starts:
+            return min(starts)
+    raise ValueError(f'Cannot resolve {text}: give an address, --elf or keep the .lst in the output tree')
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description='Query a stored trace through its on-disk indexes')
+    parser.add_argument('trace', type=Path, help='Trace file written with --dump-state')
+    parser.add_argument('--elf', type=Path, help='ELF for resolving function names')
+    parser.add_argument('--rebuild', action='store_true', help='Rebuild the index even if it is current')
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    sub.add_parser('index', help='Build the index and print its statistics')
+
+    reg_cmd = sub.add_parser('last-write', help='When was a register last written before a commit')
+    reg_cmd.add_argument('reg', type=parse_reg, help='Register (e.g. x5)')
+    reg_cmd.add_argument('--before', type=int, help='Commit index (default: end of trace)')
+
+    store_cmd = sub.add_parser('stores', help='Which commits stored to an address')
+    store_cmd.add_argument('addr', type=lambda x: int(x, 0))
+    store_cmd.add_argument('--size', type=int, default=1, help='Bytes from addr to match')
+    store_cmd.add_argument('--limit', type=int, default=20)
+
+    pc_cmd = sub.add_parser('pc', help='When did execution reach a PC or function')
+    pc_cmd.add_argument('target', help='Address or function name (e.g. bubble_sort)')
+    pc_cmd.add_argument('--limit', type=int, default=1, help='Number of hits to list (first ones)')
+
+    args = parser.parse_args()
+
+    reader = TraceReader(args.trace)
+    started = time.perf_counter()
+    index = TraceIndex(reader, rebuild=args.rebuild)
+    opened = time.perf_counter()
+    if index.built:
+        print(f'Indexed {len(reader)} commits into {index.path} in {opened - started:.2f}s')
+
+    lst_path = find_listing(args.trace)
+    listing = load_listing(lst_path) if lst_path else None
+
+    if args.command == 'index':
+        print(f'{len(reader)} commits, {len(index.pcs.keys)} distinct PCs, '
+              f'{len(index.stores.keys)} stored words, {len(index.regs.positions)} register writes')
+
+    elif args.command == 'last-write':
+        reg = args.reg
+        before = len(reader) if args.before is None else args.before
+        pos = index.last_reg_write(reg, before)
+        if pos is None:
+            print(f'x{reg} is not written before commit {before}')
+        else:
+            print(format_record(reader.record(pos), listing))
+
+    elif args.command == 'stores':
+        positions = index.stores_to(args.addr, args.size)
+        print(f'{len(positions)} stores to {args.addr:#x}')
+        for pos in positions[:args.limit]:
+            print(format_record(reader.record(pos), listing))
+
+    elif args.command == 'pc':
+        try:
+            pc = resolve_pc(args.target, args.trace, args.elf)
+        except ValueError as e:
+            parser.error(str(e))
+        hits = index.pc_hits(pc)
+        print(f'{len(hits)} commits at {pc:#x}')
+        for pos in hits[:args.limit]:
+            print(format_record(reader.record(pos), listing))
+
+    print(f'(query {(time.perf_counter() - opened) * 1000:.1f} ms)')
+
+
+if __name__ == '__main__':
+    main()
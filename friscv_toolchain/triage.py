@@ -0,0 +1,291 @@
+import argparse
+import json
+from pathlib import Path
+
+from .comparator import Mismatch, compare_run
+from .decoder import decode
+from .isa_tables import CLASSES
+from .slicer import address_reg, source_regs
+from .state import State
+
+
+MASK32 = 0xFFFFFFFF
+
+# Dependency distances beyond this are reported as 'far'
+MAX_DEP_DISTANCE = 3
+PATTERN_LENGTH = 2
+
+
+def inst_class(inst: int | None) -> str:
+    if inst is None:
+        return '?'
+    decoded = decode(inst)
+    return CLASSES[decoded.name] if decoded else 'unknown'
+
+
+def mnemonic(state: State) -> str:
+    """Mnemonic from the disassembly, or the opcode class if there is none"""
+    if state.disasm and state.disasm != 'unknown':
+        return state.disasm.split()[0]
+    return inst_class(state.inst)
+
+
+def value_relation(expected: int, actual: int, known: dict[int, int] | None = None,
+                   reg: int | None = None) -> str:
+    """
+    Describe how a wrong value relates to the right one.
+
+    Args:
+        expected: Reference value
+        actual: DUT value
+        known: Last known reference value of every register before the divergence
+        reg: Register the value belongs to, to recognise stale values
+
+    Returns:
+        Short relation name such as 'bit3-flip', 'sext8', 'stale' or 'other'
+    """
+    diff = expected ^ actual
+    if actual == 0:
+        return 'zero'
+    if diff & (diff - 1) == 0:
+        return f'bit{diff.bit_length() - 1}-flip'
+    if actual in ((expected + 1) & MASK32, (expected - 1) & MASK32):
+        return 'off-by-one'
+    for width in (8, 16):
+        low = expected & ((1 << width) - 1)
+        if actual == low:
+            return f'zext{width}'
+        if actual == (low - (1 << width) if low >> (width - 1) else low) & MASK32:
+            return f'sext{width}'
+    if actual in ((expected << 1) & MASK32, expected >> 1):
+        return 'shift-by-one'
+    if actual == expected ^ MASK32:
+        return 'inverted'
+    if actual == int.from_bytes(expected.to_bytes(4, 'little'), 'big'):
+        return 'byte-swap'
+    if known:
+        if reg is not None and known.get(reg) == actual:
+            return 'stale'
+        if actual in known.values():
+            return 'other-reg'
+    return 'other'
+
+
+def _known_regs(history: list[State]) -> dict[int, int]:
+    known = {}
+    for state in history:
+        for reg, val in state.regs.items():
+            known[reg] = val
+    return known
+
+
+def dependency_distance(mismatch: Mismatch) -> str:
+    """How many commits back a source register of the diverging instruction was written"""
+    inst = mismatch.expected.inst
+    if inst is None:
+        return '-'
+    sources = set(source_regs(inst))
+    base = address_reg(inst)
+    if base is not None:
+        sources.add(base)
+    if inst & 0x7F == 0x67:
+        sources.add((inst >> 15) & 0x1F)
+    sources.discard(0)
+    for distance, state in enumerate(reversed(mismatch.history), 1):
+        if sources & set(state.regs):
+            return str(distance) if distance <= MAX_DEP_DISTANCE else 'far'
+    return '-'
+
+
+def field_relation(mismatch: Mismatch, field: str, expected: str, actual: str) -> tuple[str, str]:
+    """Return (field kind, relation) for one differing field"""
+    if field == 'commit':
+        return 'commit', 'missing'
+
+    if field == 'pc':
+        exp, act = int(expected, 16), int(actual, 16)
+        previous = mismatch.history[-1].pc if mismatch.history else None
+        if previous is not None and act == previous + 4:
+            return 'pc', 'not-taken'
+        if previous is not None and exp == previous + 4:
+            return 'pc', 'taken'
+        return 'pc', value_relation(exp, act)
+
+    if field.startswith('x'):
+        if expected == 'None':
+            return 'rd', 'extra-write'
+        if actual == 'None':
+            return 'rd', 'missing-write'
+        return 'rd', value_relation(int(expected, 16), int(actual, 16), _known_regs(mismatch.history), int(field[1:]))
+
+    if field == 'store':
+        exp_stores, act_stores = mismatch.expected.stores, mismatch.actual.stores if mismatch.actual else []
+        if len(exp_stores) != len(act_stores):
+            return 'store', 'missing' if len(act_stores) < len(exp_stores) else 'extra'
+        for (exp_addr, exp_data), (act_addr, act_data) in zip(exp_stores, act_stores):
+            if exp_addr != act_addr:
+                return 'store-addr', value_relation(exp_addr, act_addr)
+            if exp_data != act_data:
+                return 'store-data', value_relation(exp_data, act_data, _known_regs(mismatch.history))
+        return 'store', 'other'
+
+    return field, 'other'
+
+
+def signature(mismatch: Mismatch) -> str:
+    """
+    Reduce a divergence to what it has in common with others of the same root cause:
+    the instruction, the wrong field and how it is wrong, the classes of the
+    instructions before it and the distance to the producer of its operands.
+    """
+    field, expected, actual = mismatch.fields[0]
+    kind, relation = field_relation(mismatch, field, expected, actual)
+    pattern = ','.join(inst_class(state.inst) for state in mismatch.history[-PATTERN_LENGTH:]) or '-'
+    return f'{mnemonic(mismatch.expected)} {kind}:{relation} after [{pattern}] dep={dependency_distance(mismatch)}'
+
+
+class Failure:
+    """
+    One failing test and its first divergence.
+    """
+    def __init__(self, test: str, mismatch: Mismatch) -> None:
+        self.test = test
+        self.mismatch = mismatch
+        self.signature = signature(mismatch)
+
+
+class Triage:
+    """
+    Buckets of failures sharing a signature, largest bucket first.
+    """
+    def __init__(self) -> None:
+        self.buckets: dict[str, list[Failure]] = {}
+
+
+    def add(self, test: str, mismatch: Mismatch) -> Failure:
+        failure = Failure(test, mismatch)
+        self.buckets.setdefault(failure.signature, []).append(failure)
+        return failure
+
+
+    def ranked(self) -> list[tuple[str, list[Failure]]]:
+        """Buckets by size; inside a bucket the shortest reproducer (fewest commits) comes first"""
+        buckets = [(sig, sorted(failures, key=lambda f: (f.mismatch.index, f.test)))
+                   for sig, failures in self.buckets.items()]
+        return sorted(buckets, key=lambda b: (-len(b[1]), b[0]))
+
+
+    def report(self) -> str:
+        total = sum(len(failures) for failures in self.buckets.values())
+        lines = [f'{total} failures in {len(self.buckets)} buckets']
+        for sig, failures in self.ranked():
+            shortest = failures[0]
+            lines.append(f'\n[{len(failures)}] {sig}')
+            lines.append(f'  shortest reproducer: {shortest.test} (diverges at commit {shortest.mismatch.index})')
+            lines += [f'    {line}' for line in str(shortest.mismatch).splitlines()]
+            others = [f.test for f in failures[1:]]
+            if others:
+                lines.append(f'  also: {", ".join(others[:10])}{" ..." if len(others) > 10 else ""}')
+        return '\n'.join(lines)
+
+
+    def to_json(self) -> list[dict]:
+        return [{'signature': sig,
+                 'count': len(failures),
+                 'shortest': {'test': failures[0].test, 'index': failures[0].mismatch.index},
+                 'tests': [f.test for f in failures]}
+                for sig, failures in self.ranked()]
+
+
+def _state_to_json(state: State) -> dict:
+    return {'pc': f'{state.pc:#010x}', 'inst': f'{state.inst:#010x}', 'disasm': state.disasm,
+            'regs': {str(reg): f'{val:#010x}' for reg, val in state.regs.items()},
+            'stores': [(f'{addr:#010x}', f'{data:#010x}') for addr, data in state.stores]}
+
+
+def _state_from_json(data: dict) -> State:
+    return State(0, int(data['pc'], 16), int(data['inst'], 16), data['disasm'],
+                 {int(reg): int(val, 16) for reg, val in data['regs'].items()},
+                 [(int(addr, 16), int(value, 16)) for addr, value in data['stores']])
+
+
+def save_mismatch(path: Path | str, test: str, mismatch: Mismatch) -> None:
+    """Store a divergence so a later triage run can bucket it with the rest of the regression"""
+    path = Path(path)
+    path.parent.mkdir(parents=True, exist_ok=True)
+    with open(path, 'w') as f:
+        json.dump({
+            'test': test,
+            'index': mismatch.index,
+            'fields': mismatch.fields,
+            'expected': _state_to_json(mismatch.expected),
+            'actual': _state_to_json(mismatch.actual) if mismatch.actual else None,
+            'history': [_state_to_json(state) for state in mismatch.history],
+        }, f, indent=2)
+
+
+def load_mismatch(path: Path | str) -> tuple[str, Mismatch]:
+    with open(path, 'r') as f:
+        data = json.load(f)
+    mismatch = Mismatch(
+        data['index'],
+        _state_from_json(data['expected']),
+        _state_from_json(data['actual']) if data['actual'] else None,
+        [tuple(field) for field in data['fields']],
+        [_state_from_json(state) for state in data['history']]
+    )
+    return data['test'], mismatch
+
+
+def run_lockstep(tests: list[tuple[str, object, object]], run_dir: Path, timeout: float = 1) -> Triage:
+    """
+    Compare every test's DUT with its reference in lockstep and bucket the divergences.
+
+    Each Mismatch is saved to run_dir/mismatches/<test>.json, replacing the
+    reports of an earlier run there, so the run can be bucketed again with
+    the triage CLI. Reference commits go to run_dir/traces for slicing.
+
+    Args:
+        tests: (name, reference, dut) per test, simulators as for compare_run
+        run_dir: Output directory of the run
+        timeout: Seconds to wait for each commit
+
+    Returns:
+        Triage of the diverging tests
+    """
+    mismatch_dir = Path(run_dir) / 'mismatches'
+    for stale in mismatch_dir.glob('*.json'):
+        stale.unlink()
+
+    triage = Triage()
+    for name, reference, dut in tests:
+        mismatch = compare_run(reference, dut, Path(run_dir) / 'traces' / f'{name}.trace', timeout)
+        if mismatch:
+            save_mismatch(mismatch_dir / f'{name}.json', name, mismatch)
+            triage.add(name, mismatch)
+
+    failed = sum(len(failures) for failures in triage.buckets.values())
+    print(f'{len(tests) - failed}/{len(tests)} tests matched the reference')
+    if failed:
+        print(triage.report())
+        print(f'\nMismatch reports are in {mismatch_dir}; bucket them again with: '
+              f'python3 -m friscv_toolchain.triage {mismatch_dir}')
+    return triage
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description='Bucket mismatch reports of a regression by signature')
+    parser.add_argument('paths', nargs='+', type=Path, help='Mismatch JSON files or directories of them')
+    parser.add_argument('--json', action='store_true', help='Print the buckets as JSON')
+    args = parser.parse_args()
+
+    triage = Triage()
+    for path in args.paths:
+        for file in sorted(path.glob('*.json')) if path.is_dir() else [path]:
+            triage.add(*load_mismatch(file))
+
+    print(json.dumps(triage.to_json(), indent=2) if args.json else triage.report())
+
+
+if __name__ == '__main__':
+    main()
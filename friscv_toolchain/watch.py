@@ -0,0 +1,350 @@
+import ctypes
+import ctypes.util
+import os
+import re
+import select
+import struct
+import threading
+import time
+from pathlib import Path
+
+from .checks import find_check
+from .compiler import compile_riscv_tests
+from .manifest import MANIFEST_NAME, TestSpec, discover_tests, select_tests
+from .runner import run_test
+from .spike_interface import SpikeInterface, SPIKE_OPTS, START_PC
+
+
+BUILD_SCRIPTS_DIR = Path(__file__).parent.parent / 'build_scripts'
+BUILD_SCRIPT_PATH = BUILD_SCRIPTS_DIR / 'build-tests.sh'
+# Inputs of every test: a change rebuilds all of them
+GLOBAL_INPUTS = [BUILD_SCRIPTS_DIR / name for name in ('startup.S', 'runtime.S', 'linker.ld', 'build-tests.sh')]
+
+DEBOUNCE_SECONDS = 0.2
+POLL_INTERVAL = 0.5
+
+IN_MODIFY = 0x002
+IN_ATTRIB = 0x004
+IN_CLOSE_WRITE = 0x008
+IN_MOVED_FROM = 0x040
+IN_MOVED_TO = 0x080
+IN_CREATE = 0x100
+IN_DELETE = 0x200
+IN_ISDIR = 0x40000000
+IN_NONBLOCK = 0o4000
+IN_CLOEXEC = 0o2000000
+WATCH_MASK = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE | IN_DELETE
+EVENT_HEADER = struct.Struct('iIII')
+
+INCLUDE_RE = re.compile(r'^\s*#\s*include\s+"(?P<name>[^"]+)"', re.MULTILINE)
+
+
+class InotifyWatcher:
+    """
+    Recursive directory watcher on Linux inotify, called through ctypes.
+    """
+    def __init__(self, roots: list[Path]) -> None:
+        self._libc = ctypes.CDLL(ctypes.util.find_library('c'), use_errno=True)
+        self._fd = self._libc.inotify_init1(IN_NONBLOCK | IN_CLOEXEC)
+        if self._fd < 0:
+            raise OSError(ctypes.get_errno(), 'inotify_init1 failed')
+        self._dirs: dict[int, Path] = {}
+        for root in roots:
+            for directory in [root, *(p for p in root.rglob('*') if p.is_dir())]:
+                self._add(directory)
+
+
+    def _add(self, directory: Path) -> None:
+        wd = self._libc.inotify_add_watch(self._fd, os.fsencode(directory), WATCH_MASK)
+        if wd < 0:
+            raise OSError(ctypes.get_errno(), f'inotify_add_watch failed for {directory}')
+        self._dirs[wd] = directory
+
+
+    def wait(self, timeout: float | None) -> set[Path]:
+        """Block up to timeout seconds (forever if None) and return the paths that changed"""
+        ready, _, _ = select.select([self._fd], [], [], timeout)
+        if not ready:
+            return set()
+        changed = set()
+        while True:
+            try:
+                data = os.read(self._fd, 64 * 1024)
+            except BlockingIOError:
+                return changed
+            offset = 0
+            while offset < len(data):
+                wd, mask, _, length = EVENT_HEADER.unpack_from(data, offset)
+                name = data[offset + EVENT_HEADER.size:offset + EVENT_HEADER.size + length].rstrip(b'\0')
+                offset += EVENT_HEADER.size + length
+                directory = self._dirs.get(wd)
+                if directory is None:
+                    continue
+                path = directory / os.fsdecode(name) if name else directory
+                if mask & IN_ISDIR:
+                    if mask & (IN_CREATE | IN_MOVED_TO):
+                        self._add(path)
+                    continue
+                changed.add(path)
+
+
+    def close(self) -> None:
+        os.close(self._fd)
+
+
+class PollingWatcher:
+    """
+    Portable fallback comparing modification times every POLL_INTERVAL seconds.
+    """
+    def __init__(self, roots: list[Path]) -> None:
+        self.roots = roots
+        self._snapshot = self._scan()
+
+
+    def _scan(self) -> dict[Path, int]:
+        return {p: p.stat().st_mtime_ns for root in self.roots for p in root.rglob('*') if p.is_file()}
+
+
+    def wait(self, timeout: float | None) -> set[Path]:
+        deadline = None if timeout is None else time.monotonic() + timeout
+        while True:
+            snapshot = self._scan()
+            changed = {p for p in snapshot.keys() | self._snapshot.keys()
+                       if snapshot.get(p) != self._snapshot.get(p)}
+            self._snapshot = snapshot
+            if changed or (deadline is not None and time.monotonic() >= deadline):
+                return changed
+            time.sleep(POLL_INTERVAL if deadline is None else min(POLL_INTERVAL, max(0, deadline - time.monotonic())))
+
+
+    def close(self) -> None:
+        pass
+
+
+def make_watcher(roots: list[Path]):
+    try:
+        return InotifyWatcher(roots)
+    except (OSError, AttributeError, TypeError) as e:
+        print(f'inotify unavailable ({e}); polling for changes instead')
+        return PollingWatcher(roots)
+
+
+def test_specs(test_dir: Path, select: str | None = None) -> dict[Path, TestSpec]:
+    """Tests in the manifest selection, keyed by their resolved source path"""
+    selected, _ = select_tests(discover_tests(test_dir), select)
+    return {test.source.resolve(): test for test in selected}
+
+
+def read_depfile(path: Path) -> set[Path]:
+    """Prerequisites listed in a make-style .d file written by gcc -MMD"""
+    text = path.read_text().replace('\\\n', ' ')
+    deps = set()
+    for line in text.splitlines():
+        _, sep, prerequisites = line.partition(': ')
+        if sep:
+            deps.update(Path(dep).resolve() for dep in prerequisites.split())
+    return deps
+
+
+def include_deps(source: Path, seen: set[Path] | None = None) -> set[Path]:
+    """Local headers a source includes, followed recursively"""
+    seen = set() if seen is None else seen
+    source = source.resolve()
+    if source in seen or not source.is_file():
+        return seen
+    seen.add(source)
+    for m in INCLUDE_RE.finditer(source.read_text(errors='replace')):
+        include_deps(source.parent / m.group('name'), seen)
+    return seen
+
+
+def dependency_map(test_dir: Path, bin_dir: Path, select: str | None = None) -> dict[Path, set[Path]]:
+    """
+    Inputs of every test source: the compiler's .d file when it is up to date,
+    otherwise a scan of the source's #include "..." lines.
+    """
+    deps = {}
+    for source in test_specs(test_dir, select):
+        depfile = bin_dir / f'{source.stem}.d'
+        if depfile.is_file() and depfile.stat().st_mtime_ns >= source.stat().st_mtime_ns:
+            deps[source.resolve()] = read_depfile(depfile) | {source.resolve()}
+        else:
+            deps[source.resolve()] = include_deps(source)
+    return deps
+
+
+def affected_tests(changed: set[Path], deps: dict[Path, set[Path]],
+                   design_dir: Path | None = None) -> tuple[set[Path], set[Path]]:
+    """
+    Split the tests touched by a set of changed files.
+
+    Returns:
+        (tests to rebuild and rerun, tests only to rerun because the RTL or a manifest changed)
+    """
+    changed = {p.resolve() for p in changed}
+    if changed & {p.resolve() for p in GLOBAL_INPUTS}:
+        return set(deps), set()
+    rebuild = {test for test, inputs in deps.items() if inputs & changed}
+    rerun = set()
+    if design_dir and any(design_dir.resolve() in p.parents for p in changed):
+        rerun = set(deps) - rebuild
+    # Budgets and expected results come from the manifests
+    if any(p.name == MANIFEST_NAME for p in changed):
+        rerun = set(deps) - rebuild
+    return rebuild, rerun
+
+
+class WatchSession:
+    """
+    Rebuild and rerun the tests affected by each change, one batch at a time.
+
+    A change that affects tests of the batch in flight cancels it; its
+    unfinished tests are folded into the next batch.
+    """
+    def __init__(
+        self,
+        test_dir: Path,
+        output_dir: Path,
+        spike_cmd: str,
+        riscv_tools_path: str | None = None,
+        design_dir: Path | None = None,
+        max_cycles: int | None = None,
+        timeout: float | None = None,
+        select: str | None = None
+    ) -> None:
+        self.test_dir = Path(test_dir)
+        self.output_dir = Path(output_dir)
+        self.spike_cmd = spike_cmd
+        self.riscv_tools_path = riscv_tools_path
+        self.design_dir = Path(design_dir) if design_dir else None
+        self.max_cycles = max_cycles
+        self.timeout = timeout
+        self.select = select
+
+        self._cond = threading.Condition()
+        self._rebuild: set[Path] = set()
+        self._rerun: set[Path] = set()
+        self._running: set[Path] = set()
+        self._cancel = threading.Event()
+
+
+    def submit(self, rebuild: set[Path], rerun: set[Path]) -> None:
+        with self._cond:
+            if self._running & (rebuild | rerun):
+                print('Change makes the running batch stale, cancelling it')
+                self._cancel.set()
+            self._rebuild |= rebuild
+            self._rerun |= rerun - self._rebuild
+            self._cond.notify()
+
+
+    def _take(self) -> tuple[set[Path], set[Path], threading.Event]:
+        with self._cond:
+            while not (self._rebuild or self._rerun):
+                self._cond.wait()
+            rebuild, rerun = self._rebuild, self._rerun
+            self._rebuild, self._rerun = set(), set()
+            self._running = rebuild | rerun
+            self._cancel = threading.Event()
+            return rebuild, rerun, self._cancel
+
+
+    def _finish(self, rebuild: set[Path], rerun: set[Path], done: set[Path], cancelled: bool) -> None:
+        with self._cond:
+            self._running = set()
+            if cancelled:
+                # Anything the batch did not finish goes back into the queue
+                self._rebuild |= rebuild - done
+                self._rerun |= (rerun - done) - self._rebuild
+
+
+    def _run_batch(self, rebuild: set[Path], rerun: set[Path], cancel: threading.Event) -> None:
+        done: set[Path] = set()
+        try:
+            specs = test_specs(self.test_dir, self.select)
+        except ValueError as e:
+            print(f'Error: {e}')
+            self._finish(rebuild, rerun, rebuild | rerun, False)
+            return
+        names = ', '.join(sorted(p.stem for p in rebuild | rerun))
+        print(f'\n[{time.strftime("%H:%M:%S")}] Rebuilding {len(rebuild)}, rerunning {len(rebuild | rerun)}: {names}')
+
+        built = True
+        if rebuild:
+            built = compile_riscv_tests(BUILD_SCRIPT_PATH, self.test_dir, self.output_dir,
+                                        self.riscv_tools_path, tests=sorted(rebuild))
+            if not built:
+                print('Build failed; waiting for the next change')
+
+        if built:
+            ran = passed = 0
+            for source in sorted(rebuild | rerun):
+                if cancel.is_set():
+                    break
+                spec = specs.get(source)
+                if spec is None:
+                    # No longer selected, or removed since the change was seen
+                    done.add(source)
+                    continue
+                elf_path = spec.elf_path(self.output_dir)
+                if not elf_path.is_file():
+                    print(f'  {spec.name:28} MISSING  {elf_path}')
+                    done.add(source)
+                    continue
+                spike = SpikeInterface(self.spike_cmd, 'rv32i', SPIKE_OPTS, START_PC, str(elf_path), verbose=False)
+                result = run_test(spike, max_cycles=spec.max_cycles or self.max_cycles,
+                                  timeout=spec.timeout or self.timeout, cancel=cancel)
+                if result.status != 'cancelled':
+                    done.add(source)
+                    ran += 1
+                    passed += result.status == spec.expect
+                print(f'  {result.name:28} {result.status.upper():9} {result.instret:>8} instructions  '
+                      f'{result.phases["simulate"]:.2f}s  {result.message}'
+                      f'{"" if spec.expect == "pass" else f" [expected {spec.expect}]"}')
+                if result.checks is not None and result.checks.failures:
+                    found = find_check(source, result.checks.first_id)
+                    if found:
+                        print(f'  {"":28} at {source.name}:{found[0]}: {found[1]}')
+            if ran:
+                print(f'{passed}/{ran} tests gave their expected result.')
+        else:
+            done = rebuild | rerun
+
+        self._finish(rebuild, rerun, done, cancel.is_set())
+
+
+    def _worker(self) -> None:
+        while True:
+            self._run_batch(*self._take())
+
+
+    def run(self) -> None:
+        """Run every test once, then watch until interrupted"""
+        roots = [self.test_dir, BUILD_SCRIPTS_DIR] + ([self.design_dir] if self.design_dir else [])
+        watcher = make_watcher([root.resolve() for root in roots])
+        threading.Thread(target=self._worker, daemon=True).start()
+        self.submit(set(test_specs(self.test_dir, self.select)), set())
+        print(f'Watching {", ".join(str(root) for root in roots)} (Ctrl+C to stop)')
+
+        try:
+            while True:
+                changed = watcher.wait(None)
+                # Editors write in several steps; collect the burst before acting
+                while True:
+                    more = watcher.wait(DEBOUNCE_SECONDS)
+                    if not more:
+                        break
+                    changed |= more
+                try:
+                    deps = dependency_map(self.test_dir, self.output_dir / 'bin', self.select)
+                except ValueError as e:
+                    print(f'Error: {e}')
+                    continue
+                rebuild, rerun = affected_tests(changed, deps, self.design_dir)
+                if rebuild or rerun:
+                    self.submit(rebuild, rerun)
+        except KeyboardInterrupt:
+            print('\nStopped watching.')
+            self._cancel.set()
+        finally:
+            watcher.close()
@@ -0,0 +1,458 @@
+import argparse
+import json
+import random
+import re
+import shutil
+import time
+import zlib
+from pathlib import Path
+
+from .compiler import compile_riscv_tests
+from .manifest import MANIFEST_NAME, discover_tests
+from .perfdb import PerfDB, DEFAULT_DB_PATH
+from .runner import run_test
+from .runtime_report import count_instructions
+from .spike_interface import SpikeInterface, SPIKE_OPTS, START_PC, find_spike
+
+
+BUILD_SCRIPTS_DIR = Path(__file__).parent.parent / 'build_scripts'
+BUILD_SCRIPT_PATH = BUILD_SCRIPTS_DIR / 'build-tests.sh'
+LINKER_SCRIPT_PATH = BUILD_SCRIPTS_DIR / 'linker.ld'
+HEADERS_DIR = Path(__file__).parent.parent / 'test_sources' / 'c'
+HEADERS = ('rv32i-tests.h', 'rv32i-runtime.h')
+
+# ROM kept free for the code of a kernel, the startup code and the runtime
+CODE_ALLOWANCE = 4096
+VALUES_PER_LINE = 12
+MASK32 = 0xFFFFFFFF
+
+
+class Workload:
+    """
+    One generated test: a kernel instantiated at a size and seed, with its
+    memory needs and an instruction budget.
+    """
+    def __init__(self, kernel: str, size: int, seed: int, source: str,
+                 rom_bytes: int, ram_bytes: int, max_cycles: int) -> None:
+        self.kernel = kernel
+        self.size = size
+        self.seed = seed
+        self.name = f'test_{kernel}_n{size}_s{seed}'
+        self.source = source
+        self.rom_bytes = rom_bytes
+        self.ram_bytes = ram_bytes
+        self.max_cycles = max_cycles
+
+
+def _c_array(values: list[int], fmt: str = '{}') -> str:
+    lines = []
+    for i in range(0, len(values), VALUES_PER_LINE):
+        lines.append('    ' + ', '.join(fmt.format(v) for v in values[i:i + VALUES_PER_LINE]) + ',')
+    return '\n'.join(lines)
+
+
+def _c_matrix(rows: list[list[int]]) -> str:
+    if len(rows[0]) <= VALUES_PER_LINE:
+        return '\n'.join('    { ' + ', '.join(str(v) for v in row) + ' },' for row in rows)
+    return '\n'.join('    {\n' + '\n'.join('    ' + line for line in _c_array(row).splitlines()) + '\n    },'
+                     for row in rows)
+
+
+def _rotate_xor(values: list[int]) -> int:
+    """Order-sensitive checksum, the same as the generated C loops compute"""
+    check = 0
+    for value in values:
+        check = (((check << 1) | (check >> 31)) & MASK32) ^ (value & MASK32)
+    return check
+
+
+def _header(name: str, description: str) -> str:
+    return f'// {name}.c - {description} (generated by friscv_toolchain.workloads)\n#include "rv32i-tests.h"\n'
+
+
+def sort_workload(size: int, seed: int) -> Workload:
+    """Insertion sort of size signed words, in place in RAM"""
+    rng = random.Random(seed)
+    data = [rng.randint(-32768, 32767) for _ in range(size)]
+    result = sorted(data)
+    name = f'test_sort_n{size}_s{seed}'
+    source = f'''{_header(name, f"Insertion sort of {size} words, seed {seed}")}
+#define N {size}
+
+static int data[N] = {{
+{_c_array(data)}
+}};
+
+ENTRY_POINT {{
+    for (int i = 1; i < N; i++) {{
+        int key = data[i];
+        int j = i - 1;
+        while (j >= 0 && data[j] > key) {{
+            data[j + 1] = data[j];
+            j--;
+        }}
+        data[j + 1] = key;
+    }}
+
+    unsigned int check = 0;
+    for (int i = 0; i < N; i++) {{
+        CHECK(1, i == 0 || data[i - 1] <= data[i]);
+        check = ((check << 1) | (check >> 31)) ^ (unsigned int)data[i];
+    }}
+    CHECK_EQ(2, data[0], {result[0]});
+    CHECK_EQ(3, data[N - 1], {result[-1]});
+    CHECK_EQ(4, check, {_rotate_xor(result):#010x}u);
+
+    report_result(1);
+}}
+'''
+    return Workload('sort', size, seed, source, rom_bytes=4 * size, ram_bytes=4 * size,
+                    max_cycles=12 * size * size + 40 * size + 2000)
+
+
+def search_workload(size: int, seed: int) -> Workload:
+    """Binary search of size keys, half of them present, in a sorted table of size words"""
+    rng = random.Random(seed)
+    table = sorted(2 * v for v in rng.sample(range(4 * size), size))
+    present = [rng.choice(table) for _ in range(size - size // 2)]
+    absent = [2 * rng.randrange(4 * size) + 1 for _ in range(size // 2)]
+    keys = present + absent
+    rng.shuffle(keys)
+    found = [table.index(key) for key in keys if key in table]
+    name = f'test_search_n{size}_s{seed}'
+    source = f'''{_header(name, f"Binary search of {size} keys in {size} sorted words, seed {seed}")}
+#define N {size}
+
+static const int table[N] = {{
+{_c_array(table)}
+}};
+
+static const int keys[N] = {{
+{_c_array(keys)}
+}};
+
+ENTRY_POINT {{
+    unsigned int found = 0;
+    unsigned int position_sum = 0;
+
+    for (int k = 0; k < N; k++) {{
+        int lo = 0;
+        int hi = N - 1;
+        while (lo <= hi) {{
+            int mid = (lo + hi) >> 1;
+            if (table[mid] == keys[k]) {{
+                found++;
+                position_sum += mid;
+                break;
+            }}
+            if (table[mid] < keys[k]) {{
+                lo = mid + 1;
+            }} else {{
+                hi = mid - 1;
+            }}
+        }}
+    }}
+
+    CHECK_EQ(1, found, {len(found)});
+    CHECK_EQ(2, position_sum, {sum(found)});
+
+    report_result(1);
+}}
+'''
+    return Workload('search', size, seed, source, rom_bytes=8 * size, ram_bytes=0,
+                    max_cycles=size * (20 * max(1, size.bit_length()) + 20) + 2000)
+
+
+def checksum_workload(size: int, seed: int) -> Workload:
+    """Bitwise CRC-32 (zlib polynomial) of size bytes"""
+    rng = random.Random(seed)
+    data = bytes(rng.randrange(256) for _ in range(size))
+    name = f'test_checksum_n{size}_s{seed}'
+    source = f'''{_header(name, f"CRC-32 of {size} bytes, seed {seed}")}
+#define N {size}
+
+static const unsigned char bytes[N] = {{
+{_c_array(list(data), '{:#04x}')}
+}};
+
+ENTRY_POINT {{
+    unsigned int crc = 0xFFFFFFFF;
+
+    for (int i = 0; i < N; i++) {{
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++) {{
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }}
+    }}
+
+    CHECK_EQ(1, ~crc, {zlib.crc32(data):#010x}u);
+
+    report_result(1);
+}}
+'''
+    return Workload('checksum', size, seed, source, rom_bytes=size, ram_bytes=0,
+                    max_cycles=80 * size + 2000)
+
+
+def matmul_workload(size: int, seed: int) -> Workload:
+    """
+    size x size integer matrix product, operands in ROM, result in RAM. The
+    budget allows for __mulsi3 walking all 32 bits of negative operands.
+    """
+    rng = random.Random(seed)
+    a = [[rng.randint(-8, 8) for _ in range(size)] for _ in range(size)]
+    b = [[rng.randint(-8, 8) for _ in range(size)] for _ in range(size)]
+    c = [[sum(a[i][k] * b[k][j] for k in range(size)) for j in range(size)] for i in range(size)]
+    name = f'test_matmul_n{size}_s{seed}'
+    source = f'''{_header(name, f"{size}x{size} matrix multiply, seed {seed}")}
+#define N {size}
+
+static const int a[N][N] = {{
+{_c_matrix(a)}
+}};
+
+static const int b[N][N] = {{
+{_c_matrix(b)}
+}};
+
+static int c[N][N];
+
+ENTRY_POINT {{
+    for (int i = 0; i < N; i++) {{
+        for (int j = 0; j < N; j++) {{
+            int sum = 0;
+            for (int k = 0; k < N; k++) {{
+                sum += a[i][k] * b[k][j];
+            }}
+            c[i][j] = sum;
+        }}
+    }}
+
+    unsigned int check = 0;
+    for (int i = 0; i < N; i++) {{
+        for (int j = 0; j < N; j++) {{
+            check = ((check << 1) | (check >> 31)) ^ (unsigned int)c[i][j];
+        }}
+    }}
+    CHECK_EQ(1, c[0][0], {c[0][0]});
+    CHECK_EQ(2, c[N - 1][N - 1], {c[-1][-1]});
+    CHECK_EQ(3, check, {_rotate_xor([v for row in c for v in row]):#010x}u);
+
+    report_result(1);
+}}
+'''
+    return Workload('matmul', size, seed, source, rom_bytes=8 * size * size, ram_bytes=4 * size * size,
+                    max_cycles=250 * size ** 3 + 20 * size * size + 2000)
+
+
+KERNELS = {
+    'sort': sort_workload,
+    'search': search_workload,
+    'checksum': checksum_workload,
+    'matmul': matmul_workload,
+}
+
+
+def _parse_size(text: str) -> int:
+    match = re.fullmatch(r'\s*(\d+)\s*([KM]?)\s*', text, re.IGNORECASE)
+    if not match:
+        raise ValueError(f'Cannot parse size {text!r}')
+    return int(match.group(1)) * {'': 1, 'K': 1024, 'M': 1024 * 1024}[match.group(2).upper()]
+
+
+def memory_budget(linker_script: Path = LINKER_SCRIPT_PATH) -> dict[str, int]:
+    """
+    ROM, RAM and stack sizes from the linker script the tests are built with.
+
+    Returns:
+        {'ROM': bytes, 'RAM': bytes, 'stack': bytes}
+    """
+    text = linker_script.read_text()
+    budget = {}
+    for region in ('ROM', 'RAM'):
+        match = re.search(rf'^\s*{region}\s*\([^)]*\)\s*:.*LENGTH\s*=\s*(\w+)', text, re.MULTILINE)
+        if not match:
+            raise ValueError(f'{linker_script} has no {region} region')
+        budget[region] = _parse_size(match.group(1))
+    match = re.search(r'\.stack.*?\.\s*=\s*\.\s*\+\s*(\w+)', text, re.DOTALL)
+    budget['stack'] = _parse_size(match.group(1)) if match else 0
+    return budget
+
+
+def check_fits(workload: Workload, budget: dict[str, int]) -> str | None:
+    """Why a workload does not fit the memory map, or None if it does"""
+    rom = CODE_ALLOWANCE + workload.rom_bytes
+    ram = workload.ram_bytes + budget['stack']
+    if rom > budget['ROM']:
+        return f'needs about {rom} bytes of ROM, the linker script has {budget["ROM"]}'
+    if ram > budget['RAM']:
+        return f'needs {ram} bytes of RAM including the stack, the linker script has {budget["RAM"]}'
+    return None
+
+
+def parse_sizes(text: str) -> list[int]:
+    """
+    Sizes as a comma-separated list of N, A:B (powers of two from A to B)
+    or A:B:S (A to B in steps of S), e.g. "8:1024" or "10,20:100:20".
+    """
+    sizes = []
+    for item in text.split(','):
+        parts = [int(p) for p in item.split(':')]
+        if len(parts) > 3:
+            raise ValueError(f'Cannot parse sizes {item!r}')
+        # Checked before expanding: a doubling range from 0 would never end
+        if any(part < 1 for part in parts):
+            raise ValueError(f'Sizes and steps must be positive in {item!r}')
+        if len(parts) == 1:
+            sizes.append(parts[0])
+        elif len(parts) == 2:
+            size = parts[0]
+            while size <= parts[1]:
+                sizes.append(size)
+                size *= 2
+        else:
+            sizes.extend(range(parts[0], parts[1] + 1, parts[2]))
+    if not sizes:
+        raise ValueError(f'No sizes in {text!r}')
+    return sorted(set(sizes))
+
+
+def generate(kernels: list[str], sizes: list[int], seeds: list[int], output_dir: Path,
+             linker_script: Path = LINKER_SCRIPT_PATH) -> list[Workload]:
+    """
+    Write the sources, the shared headers and a manifest for every workload that fits.
+
+    Previously generated tests in output_dir are removed first.
+
+    Returns:
+        The workloads written
+    """
+    budget = memory_budget(linker_script)
+    output_dir.mkdir(parents=True, exist_ok=True)
+    for stale in output_dir.glob('test_*.c'):
+        stale.unlink()
+    for header in HEADERS:
+        shutil.copy(HEADERS_DIR / header, output_dir / header)
+
+    written = []
+    for kernel in kernels:
+        for size in sizes:
+            for seed in seeds:
+                workload = KERNELS[kernel](size, seed)
+                problem = check_fits(workload, budget)
+                if problem:
+                    print(f'Skipping {workload.name}: {problem}')
+                    continue
+                (output_dir / f'{workload.name}.c').write_text(workload.source)
+                written.append(workload)
+
+    manifest = {
+        'defaults': {'isa': 'rv32i', 'expect': 'pass'},
+        'tests': {w.name: {'tags': ['workload', w.kernel, f'n{w.size}'], 'max_cycles': w.max_cycles}
+                  for w in written},
+    }
+    (output_dir / MANIFEST_NAME).write_text(json.dumps(manifest, indent=2) + '\n')
+    return written
+
+
+def run_sweep(workloads: list[Workload], src_dir: Path, build_dir: Path, engine: str = 'spike',
+              spike_path: str | None = None, riscv_tools_path: str | None = None,
+              db_path: Path | None = None) -> list[dict] | None:
+    """
+    Build and run generated workloads, recording them in the performance database.
+
+    Returns:
+        One row per workload, or None if the build failed
+    """
+    compile_started = time.perf_counter()
+    if not compile_riscv_tests(BUILD_SCRIPT_PATH, src_dir, build_dir, riscv_tools_path,
+                               tests=[src_dir / f'{w.name}.c' for w in workloads]):
+        print('Building the workloads failed')
+        return None
+    compile_seconds = time.perf_counter() - compile_started
+
+    specs = {spec.name: spec for spec in discover_tests(src_dir)}
+    spike_cmd = find_spike(spike_path) if engine == 'spike' else None
+    rows, results = [], []
+    for workload in workloads:
+        elf_path = specs[workload.name].elf_path(build_dir)
+        started = time.perf_counter()
+        if engine == 'spike':
+            spike = SpikeInterface(spike_cmd, 'rv32i', SPIKE_OPTS, START_PC, str(elf_path), verbose=False)
+            result = run_test(spike, max_cycles=workload.max_cycles)
+            results.append(result)
+            status, instret = result.status, result.instret
+        else:
+            counted = count_instructions(elf_path, workload.max_cycles)
+            status, instret = counted.status, counted.total
+        seconds = time.perf_counter() - started
+        rows.append({'test': workload.name, 'kernel': workload.kernel, 'size': workload.size,
+                     'seed': workload.seed, 'status': status, 'instret': instret, 'seconds': seconds,
+                     'ips': instret / seconds if seconds else 0.0})
+        print(f'  {workload.name:32} {status.upper():8} {instret:>10} instructions  {seconds:7.2f}s')
+
+    if results and db_path is not None:
+        db = PerfDB(db_path)
+        run_id = db.record_run(results, run_phases={'compile': compile_seconds}, notes='workload sweep')
+        print(f'Recorded run {run_id} in {db.path}')
+        db.close()
+    return rows
+
+
+def format_sweep(rows: list[dict]) -> str:
+    lines = [f'{"kernel":10} {"size":>7} {"seed":>5} {"status":8} {"instret":>11} {"inst/size":>10} {"inst/s":>11}']
+    for row in sorted(rows, key=lambda r: (r['kernel'], r['size'], r['seed'])):
+        lines.append(f'{row["kernel"]:10} {row["size"]:>7} {row["seed"]:>5} {row["status"]:8} {row["instret"]:>11} '
+                     f'{row["instret"] / row["size"]:>10.1f} {row["ips"]:>11.0f}')
+    return '\n'.join(lines)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description='Generate (and run) kernels at many data sizes')
+    parser.add_argument('--kernels', default=','.join(KERNELS),
+                        help=f'Comma-separated kernels out of {", ".join(KERNELS)}')
+    parser.add_argument('--sizes', default='8:256', help='N, A:B (doubling) or A:B:STEP, comma-separated')
+    parser.add_argument('--seeds', default='1', help='Comma-separated data seeds')
+    parser.add_argument('--output', type=Path, default=Path('./output/workloads'),
+                        help='Directory for the generated sources (src/) and builds (build/)')
+    parser.add_argument('--run', action='store_true', help='Build and run every generated workload')
+    parser.add_argument('--engine', choices=['spike', 'fast-forward'], default='spike',
+                        help='Simulator for --run; fast-forward needs no Spike but measures only instructions')
+    parser.add_argument('--spike-path', help='Custom path to Spike simulator')
+    parser.add_argument('--riscv-tools-path', help='Custom path to RISC-V toolchain')
+    parser.add_argument('--perf-db', type=Path, default=DEFAULT_DB_PATH,
+                        help='Performance database for Spike runs')
+    parser.add_argument('--no-perf-db', action='store_true', help='Do not record the sweep')
+    parser.add_argument('--json', type=Path, help='Write the sweep rows as JSON')
+    args = parser.parse_args()
+
+    kernels = [k.strip() for k in args.kernels.split(',') if k.strip()]
+    unknown = [k for k in kernels if k not in KERNELS]
+    if unknown:
+        parser.error(f'Unknown kernels: {", ".join(unknown)}')
+    try:
+        sizes = parse_sizes(args.sizes)
+        seeds = [int(s) for s in args.seeds.split(',')]
+    except ValueError as e:
+        parser.error(str(e))
+
+    src_dir = args.output.resolve() / 'src'
+    workloads = generate(kernels, sizes, seeds, src_dir)
+    print(f'Generated {len(workloads)} workloads in {src_dir}')
+    if not args.run or not workloads:
+        return
+
+    rows = run_sweep(workloads, src_dir, args.output.resolve() / 'build', args.engine, args.spike_path,
+                     args.riscv_tools_path, None if args.no_perf_db else args.perf_db)
+    if rows is None:
+        raise SystemExit(1)
+    print(format_sweep(rows))
+    if args.json:
+        args.json.parent.mkdir(parents=True, exist_ok=True)
+        args.json.write_text(json.dumps(rows, indent=2))
+    if any(row['status'] != 'pass' for row in rows):
+        raise SystemExit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -1,14 +1,28 @@
 import argparse
-import os
+import shlex
+import time
 from pathlib import Path
 
 from friscv_toolchain import (
     read_json,
     get_vivado_version,
     get_spike_installed,
+    find_spike,
     compile_riscv_tests,
     SpikeInterface
 )
+from friscv_toolchain.async_sim import AsyncCommitProcess, SyncSimulator
+from friscv_toolchain.checkpoint import create_restore_point, RESTORE_BASE, RESTORE_SPIKE_OPTS
+from friscv_toolchain.checks import describe_failure
+from friscv_toolchain.manifest import discover_tests, select_tests
+from friscv_toolchain.perfdb import PerfDB, tree_hash
+from friscv_toolchain.progress import ProgressTracker, commit_callback
+from friscv_toolchain.runner import run_test
+from friscv_toolchain.segments import run_segmented
+from friscv_toolchain.spike_interface import SPIKE_OPTS, START_PC
+from friscv_toolchain.trace import TraceWriter
+from friscv_toolchain.triage import run_lockstep
+from friscv_toolchain.watch import WatchSession
 
 
 def parse_args() -> argparse.Namespace | None:
@@ -49,6 +63,11 @@ def parse_args() -> argparse.Namespace | None:
                              help='Custom path to RISC-V toolchain')
 
     sim_group = parser.add_argument_group('Simulation Control')
+    sim_group.add_argument('--watch', action='store_true',
+                           help='Keep running: rebuild and rerun the tests affected by each source, build script '
+                                'or --design-dir change')
+    sim_group.add_argument('--batch', action='store_true',
+                           help='Run every test without asking for confirmation')
     sim_group.add_argument('--stop-on-error', action='store_true',
                            help='Stop verification when first error is encountered')
     sim_group.add_argument('--timeout', type=int, default=300,
@@ -59,10 +78,29 @@ def parse_args() -> argparse.Namespace | None:
                            help='Starting program counter value (default: from ELF entry point)')
     sim_group.add_argument('--incremental', action='store_true',
                            help='Continue from previous state for batch testing')
+    sim_group.add_argument('--fast-forward', dest='ff_insts', type=int, metavar='N',
+                           help='Fast-forward N instructions, then start Spike from a checkpoint restore image '
+                                '(needs 128K of main memory, see docs/usage.md)')
+    sim_group.add_argument('--ff-until-pc', type=lambda x: int(x, 0), metavar='PC',
+                           help='Fast-forward to the first execution of PC, then start Spike from there')
+    sim_group.add_argument('--segments', type=int, metavar='K',
+                           help='Split each test into K checkpointed segments and verify them in parallel')
+    sim_group.add_argument('--jobs', '-j', type=int, metavar='N',
+                           help='Number of simulator processes to run concurrently (default: one per segment)')
+
+    select_group = parser.add_argument_group('Test Selection')
+    select_group.add_argument('--select', metavar='EXPR',
+                              help='Run only the tests matching an expression over manifest tags and names, '
+                                   'e.g. "benchmark and not slow" or "memory, name:test1_*"')
+    select_group.add_argument('--list-tests', action='store_true',
+                              help='List the selected tests with their manifest metadata and exit')
 
     compare_group = parser.add_argument_group('Comparison Options')
     compare_group.add_argument('--compare', choices=['all', 'regs', 'pc', 'mem'],
                                default='all', help='Elements to compare between simulations')
+    compare_group.add_argument('--dut-cmd', metavar='CMD',
+                               help='DUT simulator printing Spike-style commit logs, with {elf} for the test ELF; '
+                                    'each test then runs in lockstep with Spike and divergences are triaged')
     compare_group.add_argument('--ignore-regs', metavar='LIST',
                                help='Comma-separated list of registers to exclude from comparison')
     compare_group.add_argument('--mem-regions', metavar='LIST',
@@ -79,6 +117,20 @@ def parse_args() -> argparse.Namespace | None:
                               help='Generate waveform dumps from Vivado simulation')
     output_group.add_argument('--waveform-format', choices=['vcd', 'wlf'],
                               default='vcd', help='Format for waveform dumps')
+    output_group.add_argument('--progress', action='store_true',
+                              help='Print a status line with pass rate, commits/s, ETA and stalled tests')
+    output_group.add_argument('--metrics-file', metavar='PATH',
+                              help='Keep an OpenMetrics text file with live run metrics up to date')
+    output_group.add_argument('--progress-interval', type=float, default=5.0, metavar='SECONDS',
+                              help='How often the status line and metrics file are refreshed')
+
+    perf_group = parser.add_argument_group('Performance History')
+    perf_group.add_argument('--perf-db', metavar='DB_PATH',
+                            help='SQLite database recording per-test results (default: OUTPUT_DIR/perf.sqlite)')
+    perf_group.add_argument('--no-perf-db', action='store_true',
+                            help='Do not record this run in the performance database')
+    perf_group.add_argument('--design-dir', metavar='RTL_DIR',
+                            help='RTL source directory, hashed to key results by design version')
 
     args = parser.parse_args()
 
@@ -97,6 +149,9 @@ def parse_args() -> argparse.Namespace | None:
         if not args.test_dir.exists() or not args.test_dir.is_dir():
             parser.error(f"Test directory not found: {args.test_dir}")
 
+    if (args.select or args.list_tests) and not args.test_dir:
+        parser.error('--select and --list-tests need --test-dir')
+
     args.output_dir = Path(args.output_dir).resolve()
     args.output_dir.mkdir(parents=True, exist_ok=True)
 
@@ -128,11 +183,42 @@ def parse_args() -> argparse.Namespace | None:
     return args
 
 
+def print_commit(index: int, state) -> None:
+    print(f'Commit {index + 1}: PC={state.pc:#010x}, Instruction={state.inst:#010x}, Disasm={state.disasm}')
+
+    for reg, val in state.regs.items():
+        print(f'  x{reg} = {val:#010x}')
+
+    for addr, data in state.stores:
+        print(f'  Store: {addr:#010x} -> {data:#010x}')
+
+
 def main() -> None:
     args = parse_args()
     if not args:
         return
 
+    selected = []
+    if args.test_dir:
+        try:
+            selected, unsupported = select_tests(discover_tests(args.test_dir), args.select)
+        except ValueError as e:
+            print(f'Error: {e}')
+            return
+        for spec in unsupported:
+            print(f'Skipping {spec.name}: needs {spec.isa}, the simulator runs rv32i')
+
+        if args.list_tests:
+            for spec in selected:
+                budgets = f'max_cycles={spec.max_cycles or args.max_cycles} timeout={spec.timeout or args.timeout}'
+                print(f'{spec.name:24} {",".join(sorted(spec.tags)):32} expect={spec.expect:4} {budgets}  '
+                      f'{spec.source.relative_to(args.test_dir)}')
+            print(f'{len(selected)} tests selected')
+            return
+        if not selected:
+            print(f'No tests selected{f" by {args.select!r}" if args.select else ""} in {args.test_dir}. Exiting.')
+            return
+
     try:
         toolchain_config_data = read_json(args.config_file)
         if not toolchain_config_data:
@@ -168,15 +254,32 @@ def main() -> None:
 
     print('Looking for Spike...')
     if get_spike_installed(args.spike_path):
-        spike_loc = args.spike_path if args.spike_path else "system PATH"
-        print(f'Spike is installed and accessible from {spike_loc}.')
+        spike_cmd = find_spike(args.spike_path)
+        print(f'Spike is installed and accessible at {spike_cmd}.')
     else:
         print('Spike is not installed or not accessible.')
         return
 
     print('\nAll dependencies are satisfied.\n')
 
+    if args.watch:
+        if not args.test_dir:
+            print('--watch needs --test-dir. Exiting.')
+            return
+        WatchSession(
+            test_dir=args.test_dir,
+            output_dir=args.output_dir,
+            spike_cmd=spike_cmd,
+            riscv_tools_path=args.riscv_tools_path,
+            design_dir=args.design_dir,
+            max_cycles=args.max_cycles,
+            timeout=args.timeout,
+            select=args.select
+        ).run()
+        return
+
     compiled_elf_dir: Path | None = None
+    run_phases: dict[str, float] = {}
     if args.test_dir:
         print(f'Mode: Batch processing tests from directory: {args.test_dir}')
         python_script_dir = Path(__file__).parent.resolve()
@@ -187,12 +290,15 @@ def main() -> None:
             print('Please ensure \'build-tests.sh\' is correctly located or configure its path.')
             return
 
+        compile_started = time.perf_counter()
         compilation_successful = compile_riscv_tests(
             bash_script_path=build_script_path,
             test_src_dir=args.test_dir,
             output_base_dir=args.output_dir,
-            riscv_tools_path=args.riscv_tools_path
+            riscv_tools_path=args.riscv_tools_path,
+            tests=[spec.source for spec in selected]
         )
+        run_phases['compile'] = time.perf_counter() - compile_started
 
         if not compilation_successful:
             print('Test compilation failed. Exiting.')
@@ -221,53 +327,125 @@ def main() -> None:
         print('No compiled ELF directory provided. Exiting.')
         return
     
+    if args.segments:
+        all_passed = True
+        for spec in selected:
+            all_passed &= run_segmented(
+                elf_path=spec.elf_path(args.output_dir),
+                num_segments=args.segments,
+                output_dir=args.output_dir / 'segments',
+                spike_path=spike_cmd,
+                jobs=args.jobs,
+                riscv_tools_path=args.riscv_tools_path
+            )
+            if not all_passed and args.stop_on_error:
+                break
+        print('All segments passed.' if all_passed else 'Segment verification failed.')
+        return
+
     spike_sims = []
 
-    for filename in os.listdir(compiled_elf_dir):
-        if filename.endswith('.elf'):
-            elf_path = compiled_elf_dir / filename
-            print(f'Found ELF file: {elf_path}')
-            spike_sims.append(
-                SpikeInterface(
-                    spike_path='spike' if args.spike_path is None else args.spike_path,
-                    isa='rv32i',
-                    base_opts='-m0x80000000:0x10000,0x20000000:0x1000',
-                    start_pc='0x80000000',
-                    elf_path=str(elf_path),
-                )
+    for spec in selected:
+        elf_path = spec.elf_path(args.output_dir)
+        if not elf_path.is_file():
+            print(f'Skipping {spec.name}: {elf_path} was not built.')
+            continue
+        print(f'Found ELF file: {elf_path}')
+        base_opts = SPIKE_OPTS
+        start_pc = START_PC
+
+        if args.ff_insts is not None or args.ff_until_pc is not None:
+            restore_point = create_restore_point(
+                elf_path=elf_path,
+                output_dir=args.output_dir / 'checkpoints',
+                max_insts=args.ff_insts,
+                until_pc=args.ff_until_pc,
+                riscv_tools_path=args.riscv_tools_path
             )
+            if restore_point is None:
+                print(f'Skipping {elf_path}: could not create restore point.')
+                continue
+            elf_path = restore_point[1]
+            base_opts = RESTORE_SPIKE_OPTS
+            start_pc = f'{RESTORE_BASE:#x}'
+
+        spike_sims.append((spec, SpikeInterface(
+            spike_path=spike_cmd,
+            isa='rv32i',
+            base_opts=base_opts,
+            start_pc=start_pc,
+            elf_path=str(elf_path),
+        )))
 
     print()
 
-    for spike in sorted(spike_sims, key=lambda x: x.elf_path):
-        print(f'Start test {spike.elf_path}? (y/n) ', end='')
-        if input().strip().lower() != 'y':
-            print('Skipping test.')
-            continue
+    if args.dut_cmd:
+        tests = [(spec.name, spike, SyncSimulator(AsyncCommitProcess(
+                    shlex.split(args.dut_cmd.format(elf=spike.elf_path)), spike.elf_path)))
+                 for spec, spike in spike_sims]
+        run_lockstep(tests, args.output_dir)
+        return
+
+    progress = None
+    if args.progress or args.metrics_file:
+        progress = ProgressTracker(len(spike_sims), metrics_path=args.metrics_file, status=args.progress,
+                                   interval=args.progress_interval)
+        progress.start()
+
+    results = []
+    passed = 0
+    for spec, spike in spike_sims:
+        if not args.batch:
+            print(f'Start test {spike.elf_path}? (y/n) ', end='')
+            if input().strip().lower() != 'y':
+                print('Skipping test.')
+                continue
 
         print(f'Starting Spike simulation for {spike.elf_path}...')
+        trace = None
+        if args.dump_state:
+            trace = TraceWriter(args.output_dir / 'traces' / f'{Path(spike.elf_path).stem}.trace')
+        on_commit = print_commit if args.verbose >= 2 else None
+        if progress:
+            progress.test_started(0, spec.name)
+            on_commit = commit_callback(progress, 0, on_commit)
         try:
-            spike.start()            
-            for i in range(10):
-                print(f'Waiting for commit {i + 1}...')
-                state = spike.next_commit(timeout=5)
-                if state is None:
-                    print('No more commits or timeout reached.')
-                    break
-
-                print(f'Commit {i + 1}: PC={state.pc}, Instruction={state.inst}, Disasm={state.disasm}')
-
-                for reg, val in state.regs.items():
-                    print(f'  x{reg} = {val:#x}')
-
-                for addr, data in state.stores:
-                    print(f'  Store: {addr:#x} -> {data:#x}')
-        
-        except Exception as e:
-            print(f'Error during simulation: {e}')
+            result = run_test(
+                spike,
+                max_cycles=spec.max_cycles or args.max_cycles,
+                timeout=spec.timeout or args.timeout,
+                trace=trace,
+                on_commit=on_commit
+            )
         finally:
-            spike.stop()
-            print(f'Simulation for {spike.elf_path} completed.\n')
+            if trace:
+                trace.close()
+                print(f'Trace written to {trace.path} ({trace.count} commits)')
+        if progress:
+            progress.test_finished(0, result.status)
+
+        as_expected = result.status == spec.expect
+        print(f'{result.name}: {result.status.upper()} after {result.instret} instructions '
+              f'in {result.phases["simulate"]:.2f}s ({result.message})'
+              f'{"" if spec.expect == "pass" else f" [expected {spec.expect}]"}')
+        if result.checks is not None and result.checks.failures:
+            print(describe_failure(result.checks, spec.source))
+        print(f'Simulation for {spike.elf_path} completed.\n')
+        results.append(result)
+        passed += as_expected
+        if args.stop_on_error and not as_expected:
+            break
+
+    if progress:
+        progress.stop()
+    if results:
+        print(f'{passed}/{len(results)} tests gave their expected result.')
+
+    if results and not args.no_perf_db:
+        db = PerfDB(args.perf_db or args.output_dir / 'perf.sqlite')
+        run_id = db.record_run(results, design_hash=tree_hash(args.design_dir), run_phases=run_phases)
+        print(f'Recorded run {run_id} in {db.path}')
+        db.close()
 
 
 if __name__ == "__main__":
@@ -1 +1 @@
-python3 ./main.py --test-dir ./test_sources/c
\ No newline at end of file
+python3 ./main.py --test-dir ./test_sources
\ No newline at end of file
@@ -0,0 +1,178 @@
+// rv32i-asm-tests.h - Self-checking macros for assembly tests
+//
+// Included from test*.S files, which go through the C preprocessor. A test
+// is TEST_BEGIN, any number of TEST_* checks and TEST_END; data for loads
+// and stores goes in .data after TEST_END. Checks do not stop at the first
+// failure: TEST_END writes the same results block as report_result() in
+// rv32i-tests.h and then TEST_RESULT, so the toolchain reports failing
+// checks by ID for both kinds of test.
+//
+// Register use: x11/x12 hold source operands, x13 the base address, x14 the
+// result and t6 the expected value. s7-s11 hold the check state and must not
+// be written by test code.
+#ifndef RV32I_ASM_TESTS_H
+#define RV32I_ASM_TESTS_H
+
+// Same protocol as rv32i-tests.h
+#define TEST_RESULT     0x20000000
+#define TEST_PASSED     0x1
+#define TEST_FAILED     0x2
+#define TEST_CHECKS     0x20000004
+#define CHECKS_MAGIC    0x314b4843
+
+// Check state, the fields of the results block
+#define CHECKS_RUN      s11     // Checks executed
+#define CHECKS_FAILED   s10     // Checks that failed
+#define FIRST_ID        s9      // ID of the first failing check
+#define FIRST_EXPECTED  s8      // Expected value of the first failing check
+#define FIRST_ACTUAL    s7      // Actual value of the first failing check
+
+// Entry point called by startup.S
+#define TEST_BEGIN                                  \
+    .section .text.init, "ax", @progbits;           \
+    .globl _start;                                  \
+_start:                                             \
+    li CHECKS_RUN, 0;                               \
+    li CHECKS_FAILED, 0;                            \
+    li FIRST_ID, 0;                                 \
+    li FIRST_EXPECTED, 0;                           \
+    li FIRST_ACTUAL, 0
+
+// Write the results block, then TEST_RESULT, and stop
+#define TEST_END                                    \
+    li t0, TEST_CHECKS;                             \
+    li t1, CHECKS_MAGIC;                            \
+    sw t1, 0(t0);                                   \
+    sw CHECKS_RUN, 4(t0);                           \
+    sw CHECKS_FAILED, 8(t0);                        \
+    sw FIRST_ID, 12(t0);                            \
+    sw FIRST_EXPECTED, 16(t0);                      \
+    sw FIRST_ACTUAL, 20(t0);                        \
+    li t1, TEST_PASSED;                             \
+    beqz CHECKS_FAILED, 1f;                         \
+    li t1, TEST_FAILED;                             \
+1:  li t0, TEST_RESULT;                             \
+    sw t1, 0(t0);                                   \
+2:  j 2b
+
+// Record one check of reg against expreg; a passing check costs two instructions
+#define CHECK_REG(id, reg, expreg)                  \
+    addi CHECKS_RUN, CHECKS_RUN, 1;                 \
+    beq reg, expreg, 9f;                            \
+    bnez CHECKS_FAILED, 8f;                         \
+    li FIRST_ID, id;                                \
+    mv FIRST_EXPECTED, expreg;                      \
+    mv FIRST_ACTUAL, reg;                           \
+8:  addi CHECKS_FAILED, CHECKS_FAILED, 1;           \
+9:
+
+// Run code, then check reg against a constant
+#define TEST_CASE(id, reg, correctval, code...)     \
+    code;                                           \
+    li t6, correctval;                              \
+    CHECK_REG(id, reg, t6)
+
+#define TEST_NOPS(n)                                \
+    .rept n; nop; .endr
+
+//------------------------------------------------------------------------
+// Register-register and register-immediate operations
+//------------------------------------------------------------------------
+
+#define TEST_RR_OP(id, inst, result, val1, val2)    \
+    TEST_CASE(id, x14, result,                      \
+        li x11, val1;                               \
+        li x12, val2;                               \
+        inst x14, x11, x12)
+
+#define TEST_IMM_OP(id, inst, result, val1, imm)    \
+    TEST_CASE(id, x14, result,                      \
+        li x11, val1;                               \
+        inst x14, x11, imm)
+
+// Destination is also a source
+#define TEST_RR_SRC1_EQ_DEST(id, inst, result, val1, val2) \
+    TEST_CASE(id, x11, result,                      \
+        li x11, val1;                               \
+        li x12, val2;                               \
+        inst x11, x11, x12)
+
+// Writes to x0 are discarded
+#define TEST_RR_ZERODEST(id, inst, val1, val2)      \
+    TEST_CASE(id, x0, 0,                            \
+        li x11, val1;                               \
+        li x12, val2;                               \
+        inst x0, x11, x12)
+
+//------------------------------------------------------------------------
+// Loads and stores; base is a label in .data
+//------------------------------------------------------------------------
+
+#define TEST_LD_OP(id, inst, result, offset, base)  \
+    TEST_CASE(id, x14, result,                      \
+        la x13, base;                               \
+        inst x14, offset(x13))
+
+// Store val, then load it back with load_inst; result is what the load returns
+#define TEST_ST_OP(id, load_inst, store_inst, result, val, offset, base) \
+    TEST_CASE(id, x14, result,                      \
+        la x13, base;                               \
+        li x12, val;                                \
+        store_inst x12, offset(x13);                \
+        load_inst x14, offset(x13))
+
+//------------------------------------------------------------------------
+// Branches: x14 is 1 if the branch was taken
+//------------------------------------------------------------------------
+
+#define TEST_BR_OP(id, inst, taken, val1, val2)     \
+    TEST_CASE(id, x14, taken,                       \
+        li x11, val1;                               \
+        li x12, val2;                               \
+        li x14, 1;                                  \
+        inst x11, x12, 3f;                          \
+        li x14, 0;                                  \
+3:)
+
+//------------------------------------------------------------------------
+// Hazards: a result consumed nops instructions after it is produced
+//------------------------------------------------------------------------
+
+// Operands produced src1_nops and src2_nops instructions before use
+#define TEST_RR_SRC_BYPASS(id, src1_nops, src2_nops, inst, result, val1, val2) \
+    TEST_CASE(id, x14, result,                      \
+        li x11, val1;                               \
+        TEST_NOPS(src1_nops);                       \
+        li x12, val2;                               \
+        TEST_NOPS(src2_nops);                       \
+        inst x14, x11, x12)
+
+// ALU result consumed nops instructions later
+#define TEST_RR_DEST_BYPASS(id, nops, inst, result, val1, val2) \
+    TEST_CASE(id, x15, result,                      \
+        li x11, val1;                               \
+        li x12, val2;                               \
+        inst x14, x11, x12;                         \
+        TEST_NOPS(nops);                            \
+        addi x15, x14, 0)
+
+// Load result consumed nops instructions later (load-use hazard at 0)
+#define TEST_LD_DEST_BYPASS(id, nops, inst, result, offset, base) \
+    TEST_CASE(id, x15, result,                      \
+        la x13, base;                               \
+        inst x14, offset(x13);                      \
+        TEST_NOPS(nops);                            \
+        addi x15, x14, 0)
+
+// Branch operands produced nops instructions before the branch
+#define TEST_BR_SRC_BYPASS(id, nops, inst, taken, val1, val2) \
+    TEST_CASE(id, x14, taken,                       \
+        li x14, 1;                                  \
+        li x11, val1;                               \
+        li x12, val2;                               \
+        TEST_NOPS(nops);                            \
+        inst x11, x12, 3f;                          \
+        li x14, 0;                                  \
+3:)
+
+#endif // RV32I_ASM_TESTS_H
@@ -0,0 +1,53 @@
+// rv32i-runtime.h - Division by constants without a divide instruction
+#ifndef RV32I_RUNTIME_H
+#define RV32I_RUNTIME_H
+
+// On plain RV32I even n / 10 becomes a __udivsi3 call. These helpers
+// multiply by the reciprocal with shifts and adds, then correct the
+// estimate from the remainder (Hacker's Delight, ch. 10). Exact for all
+// 32-bit inputs. General * / % go through build_scripts/runtime.S.
+
+static inline unsigned int udiv3(unsigned int n) {
+    unsigned int q = (n >> 2) + (n >> 4);
+    q += q >> 4;
+    q += q >> 8;
+    q += q >> 16;
+    unsigned int r = n - ((q << 1) + q);
+    return q + (((r << 3) + (r << 1) + r) >> 5);  // q + r / 3 for r <= 15
+}
+
+static inline unsigned int udiv5(unsigned int n) {
+    unsigned int q = (n >> 3) + (n >> 4);
+    q += q >> 4;
+    q += q >> 8;
+    q += q >> 16;
+    unsigned int r = n - ((q << 2) + q);
+    return q + (((r << 3) + (r << 2) + r) >> 6);  // q + r / 5 for r <= 24
+}
+
+static inline unsigned int udiv10(unsigned int n) {
+    unsigned int q = (n >> 1) + (n >> 2);
+    q += q >> 4;
+    q += q >> 8;
+    q += q >> 16;
+    q >>= 3;
+    unsigned int r = n - (((q << 2) + q) << 1);
+    return q + (r > 9);
+}
+
+static inline unsigned int umod3(unsigned int n) {
+    unsigned int q = udiv3(n);
+    return n - ((q << 1) + q);
+}
+
+static inline unsigned int umod5(unsigned int n) {
+    unsigned int q = udiv5(n);
+    return n - ((q << 2) + q);
+}
+
+static inline unsigned int umod10(unsigned int n) {
+    unsigned int q = udiv10(n);
+    return n - (((q << 2) + q) << 1);
+}
+
+#endif // RV32I_RUNTIME_H
@@ -2,11 +2,28 @@
 #ifndef RV32I_TESTS_H
 #define RV32I_TESTS_H
 
+#include "rv32i-runtime.h"
+
 // Memory-mapped I/O addresses (example)
 #define UART_TX         0x10000000  // UART transmit register
 #define TEST_RESULT     0x20000000  // Memory address to write test results
 #define TEST_PASSED     0x1         // Value indicating test passed
 #define TEST_FAILED     0x2         // Value indicating test failed
+#define TEST_CHECKS     0x20000004  // Results block, written just before TEST_RESULT
+#define CHECKS_MAGIC    0x314b4843  // "CHK1" marks a valid results block
+
+// Results block at TEST_CHECKS: which check failed first and with what values,
+// so a failure can be triaged without re-running with a full trace
+typedef struct {
+    unsigned int magic;     // CHECKS_MAGIC
+    unsigned int checks;    // Checks executed
+    unsigned int failures;  // Checks that failed
+    unsigned int first_id;  // ID of the first failing check, 0 if none failed
+    unsigned int expected;  // Expected value of the first failing check
+    unsigned int actual;    // Actual value of the first failing check
+} check_block_t;
+
+static check_block_t check_state __attribute__((unused));
 
 // Helper functions
 static inline void write_reg(volatile unsigned int* addr, unsigned int val) {
@@ -17,10 +34,33 @@ static inline unsigned int read_reg(volatile unsigned int* addr) {
     return *addr;
 }
 
-// Simple function to report test status
+// Record one check; only the first failure keeps its ID and values
+static inline void check_eq(unsigned int id, unsigned int actual, unsigned int expected) {
+    check_state.checks++;
+    if (actual != expected && check_state.failures++ == 0) {
+        check_state.first_id = id;
+        check_state.expected = expected;
+        check_state.actual = actual;
+    }
+}
+
+// IDs must be unique non-zero literals within a test; the toolchain finds
+// the failing check in the source by its ID
+#define CHECK_EQ(id, actual, expected) check_eq((id), (unsigned int)(actual), (unsigned int)(expected))
+#define CHECK(id, cond)                check_eq((id), (cond) ? 1 : 0, 1)
+
+// Simple function to report test status; any failed check fails the test
 static inline void report_result(int passed) {
+    volatile check_block_t* block = (volatile check_block_t*)TEST_CHECKS;
+    block->magic = CHECKS_MAGIC;
+    block->checks = check_state.checks;
+    block->failures = check_state.failures;
+    block->first_id = check_state.first_id;
+    block->expected = check_state.expected;
+    block->actual = check_state.actual;
+
     volatile unsigned int* result = (volatile unsigned int*)TEST_RESULT;
-    *result = passed ? TEST_PASSED : TEST_FAILED;
+    *result = (passed && check_state.failures == 0) ? TEST_PASSED : TEST_FAILED;
 
     // Infinite loop to signal end of test
     while(1) { }
@@ -6,7 +6,6 @@ ENTRY_POINT {
     int b = 5;
     int c = 10;
     int result = 0;
-    int passed = 1;
 
     // Test branch equal - should branch
     if (a == c) {
@@ -39,9 +38,7 @@ ENTRY_POINT {
     }
 
     // All branches should have been taken, result should be 63
-    if (result != 63) {
-        passed = 0;
-    }
+    CHECK_EQ(1, result, 63);
 
     // Negative test: branch equal - should not branch
     result = 100;
@@ -50,9 +47,7 @@ ENTRY_POINT {
     }
 
     // Should still be 100
-    if (result != 100) {
-        passed = 0;
-    }
+    CHECK_EQ(2, result, 100);
 
-    report_result(passed);
+    report_result(1);
 }
@@ -8,7 +8,6 @@ void function3(void);
 
 ENTRY_POINT {
     int result = 0;
-    int passed = 1;
 
     // Test JAL (jump and link) - call function1
     function1();
@@ -17,9 +16,7 @@ ENTRY_POINT {
     function2(&result);
 
     // Result should be 42 after function2
-    if (result != 42) {
-        passed = 0;
-    }
+    CHECK_EQ(1, result, 42);
 
     // Test complex control flow with multiple jumps
     result = 0;
@@ -33,11 +30,9 @@ ENTRY_POINT {
     }
 
     // Sum should be 0 + 2 + 2 + 6 + 4 + 10 + 6 + 14 + 8 + 18 = 70
-    if (result != 70) {
-        passed = 0;
-    }
+    CHECK_EQ(2, result, 70);
 
-    report_result(passed);
+    report_result(1);
 }
 
 // Function using JAL to call another function
@@ -21,17 +21,12 @@ unsigned int fibonacci(unsigned int n) {
 }
 
 ENTRY_POINT {
-    int passed = 1;
-
     // Test known Fibonacci values
     unsigned int expected_values[] = {0, 1, 1, 2, 3, 5, 8, 13, 21, 34, 55, 89, 144};
 
     for (unsigned int i = 0; i <= 12; i++) {
-        if (fibonacci(i) != expected_values[i]) {
-            passed = 0;
-            break;
-        }
+        CHECK_EQ(1, fibonacci(i), expected_values[i]);
     }
 
-    report_result(passed);
+    report_result(1);
 }
@@ -19,8 +19,6 @@ int is_prime(unsigned int n) {
 }
 
 ENTRY_POINT {
-    int passed = 1;
-
     // Known prime numbers under 100
     unsigned int primes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41,
                              43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97};
@@ -38,11 +36,8 @@ ENTRY_POINT {
         }
 
         // Test if our is_prime function agrees
-        if (is_prime(i) != should_be_prime) {
-            passed = 0;
-            break;
-        }
+        CHECK_EQ(1, is_prime(i), should_be_prime);
     }
 
-    report_result(passed);
+    report_result(1);
 }
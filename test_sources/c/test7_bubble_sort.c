@@ -27,35 +27,31 @@ int is_sorted(int arr[], int n) {
 }
 
 ENTRY_POINT {
-    int passed = 1;
-
     // Test case 1: Already sorted array
     int arr1[] = {1, 2, 3, 4, 5};
     bubble_sort(arr1, 5);
-    if (!is_sorted(arr1, 5)) {
-        passed = 0;
-    }
+    CHECK(1, is_sorted(arr1, 5));
 
     // Test case 2: Reverse sorted array
     int arr2[] = {5, 4, 3, 2, 1};
     bubble_sort(arr2, 5);
-    if (!is_sorted(arr2, 5) || arr2[0] != 1 || arr2[4] != 5) {
-        passed = 0;
-    }
+    CHECK(2, is_sorted(arr2, 5));
+    CHECK_EQ(3, arr2[0], 1);
+    CHECK_EQ(4, arr2[4], 5);
 
     // Test case 3: Random array
     int arr3[] = {3, 1, 4, 1, 5, 9, 2, 6, 5};
     bubble_sort(arr3, 9);
-    if (!is_sorted(arr3, 9) || arr3[0] != 1 || arr3[8] != 9) {
-        passed = 0;
-    }
+    CHECK(5, is_sorted(arr3, 9));
+    CHECK_EQ(6, arr3[0], 1);
+    CHECK_EQ(7, arr3[8], 9);
 
     // Test case 4: Array with duplicates
     int arr4[] = {3, 3, 1, 4, 1};
     bubble_sort(arr4, 5);
-    if (!is_sorted(arr4, 5) || arr4[0] != 1 || arr4[4] != 4) {
-        passed = 0;
-    }
+    CHECK(8, is_sorted(arr4, 5));
+    CHECK_EQ(9, arr4[0], 1);
+    CHECK_EQ(10, arr4[4], 4);
 
-    report_result(passed);
+    report_result(1);
 }
@@ -0,0 +1,71 @@
+// test8_runtime.c - Multiply/divide runtime and constant-divisor helpers test
+#include "rv32i-tests.h"
+
+// Volatile operands keep the compiler from folding the operations away
+static volatile unsigned int u_ops[] = {0, 1, 7, 10, 100, 12345, 0x10000, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF};
+static volatile int s_ops[] = {-2147483647 - 1, -100, -7, -3, 1, 7, 100, 2147483647};
+
+ENTRY_POINT {
+    volatile unsigned int a = 12345;
+    volatile unsigned int b = 678;
+    volatile int c = -12345;
+    volatile int d = 678;
+
+    // Multiply (__mulsi3), including wrap-around and operand order
+    CHECK_EQ(1, a * b, 8369910);
+    CHECK_EQ(2, b * a, 8369910);
+    CHECK_EQ(3, c * d, -8369910);
+    CHECK_EQ(4, c * -d, 8369910);
+    CHECK_EQ(5, a * 0xFFFFFFFFu, -12345);
+    CHECK_EQ(6, 0x10000u * a * a, 0x6CB10000);
+
+    // Unsigned divide and remainder (__udivsi3, __umodsi3)
+    CHECK_EQ(7, a / b, 18);
+    CHECK_EQ(8, a % b, 141);
+    CHECK_EQ(9, b / a, 0);
+    CHECK_EQ(10, b % a, 678);
+    CHECK_EQ(11, u_ops[9] / u_ops[1], 0xFFFFFFFF);
+    CHECK_EQ(12, u_ops[9] / u_ops[8], 1);
+    CHECK_EQ(13, u_ops[9] % u_ops[8], 0x7FFFFFFF);
+    CHECK_EQ(14, u_ops[8] / u_ops[3], 214748364);
+
+    // Signed divide and remainder truncate toward zero (__divsi3, __modsi3)
+    CHECK_EQ(15, c / d, -18);
+    CHECK_EQ(16, c % d, -141);
+    CHECK_EQ(17, -c / -d, -18);
+    CHECK_EQ(18, c / -d, 18);
+    CHECK_EQ(19, -c % -d, 141);
+    CHECK_EQ(20, s_ops[0] / s_ops[6], -21474836);
+    CHECK_EQ(21, s_ops[0] % s_ops[6], -48);
+    CHECK_EQ(22, s_ops[0] / s_ops[4], -2147483647 - 1);
+    CHECK_EQ(23, s_ops[2] % s_ops[6], -7);
+
+    // Quotient and remainder agree for every operand pair
+    for (unsigned int i = 0; i < sizeof(u_ops) / sizeof(u_ops[0]); i++) {
+        for (unsigned int j = 1; j < sizeof(u_ops) / sizeof(u_ops[0]); j++) {
+            unsigned int n = u_ops[i], m = u_ops[j];
+            CHECK_EQ(24, (n / m) * m + n % m, n);
+            CHECK(25, n % m < m);
+        }
+    }
+    for (unsigned int i = 0; i < sizeof(s_ops) / sizeof(s_ops[0]); i++) {
+        for (unsigned int j = 1; j < sizeof(s_ops) / sizeof(s_ops[0]); j++) {
+            int n = s_ops[i], m = s_ops[j];
+            CHECK_EQ(26, (n / m) * m + n % m, n);
+        }
+    }
+
+    // Constant-divisor helpers match the generic division
+    for (unsigned int i = 0; i < sizeof(u_ops) / sizeof(u_ops[0]); i++) {
+        unsigned int n = u_ops[i];
+        volatile unsigned int three = 3, five = 5, ten = 10;
+        CHECK_EQ(27, udiv3(n), n / three);
+        CHECK_EQ(28, udiv5(n), n / five);
+        CHECK_EQ(29, udiv10(n), n / ten);
+        CHECK_EQ(30, umod3(n), n % three);
+        CHECK_EQ(31, umod5(n), n % five);
+        CHECK_EQ(32, umod10(n), n % ten);
+    }
+
+    report_result(1);
+}